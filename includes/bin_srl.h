@@ -10,6 +10,15 @@
 #include <memory>
 #include <cxxabi.h>
 #include <type_traits>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include "parallel.h"
+#include "block_stream.h"
 #include "type_mtr.h"
 #include "type_info.h"
 
@@ -31,25 +40,35 @@ namespace bin_srl {
      * @return the output size of binary data
      */
     template<class T>
-    unsigned int write_bin(const T& obj, std::ofstream& file) {
+    unsigned int write_bin(const T& obj, std::ostream& file) {
+        type_info::identity_scope identity(!std::is_arithmetic<RR(T)>::value);
         if constexpr (std::is_arithmetic<RR(T)>::value) {                                                               // arithmetic type
             file.write(reinterpret_cast<const char *>(&obj), sizeof(T));
             return sizeof(T);
-        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_unique_ptr<RR(T)>::value) {            // pointer type
+        } else if constexpr (my_type_traits::is_unique_ptr<RR(T)>::value) {                                             // unique_ptr type
             return write_bin(*obj, file);
+        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_shared_ptr<RR(T)>::value) {            // pointer type, written once
+            unsigned int ref = 0;
+            bool fresh = type_info::track_written(obj, ref);
+            unsigned int size = write_bin(ref, file);
+            return fresh ? size + write_bin(*obj, file) : size;
         } else if constexpr (std::is_array<RR(T)>::value) {                                                             // array type
+            if (type_info::is_plain<RR(T)>()) {                                                                         // one block
+                return type_info::write_block(&obj, 1, file);
+            }
             unsigned int size = 0;
             for (int i = 0; i < (int)std::extent<RR(T)>::value; ++ i) {                                                 // for each element
                 size += write_bin(obj[i], file);
             }
             return size;
-        } else if constexpr (std::is_same<RR(T), std::string>::value) {                                                 // string type   
+        } else if constexpr (my_type_traits::is_string<RR(T)>::value) {                                                 // string type   
+            if (type_info::string_dictionary) {                                                                         // through the dictionary
+                return type_info::write_dictionary_string(obj, file);
+            }
             unsigned int size = 0, len = obj.length();
             size += write_bin(static_cast<unsigned int &>(len), file);
-            for (int i = 0; i < (int)len; ++ i) {
-                size += write_bin(obj[i], file);
-            }
-            return size;
+            file.write(obj.data(), len);
+            return size + len;
         } else if constexpr (my_type_traits::is_pair<RR(T)>::value) {                                                   // pair type
             unsigned int size = 0;
             size += write_bin(obj.first, file);
@@ -58,23 +77,81 @@ namespace bin_srl {
         } else if constexpr (my_type_traits::is_container<RR(T)>::value) {                                              // container type
             unsigned int size = 0, cnt = obj.size();
             size += write_bin(static_cast<unsigned int &>(cnt), file);
-            for (auto i : obj) {
+            if constexpr (type_info::packable<RR(T)>()) {
+                if (type_info::packed_keys) {                                                                           // packed keys
+                    return size + type_info::write_packed(obj, file, [&](const auto &value) { return write_bin(value, file); });
+                }
+            }
+            if constexpr (my_type_traits::is_contiguous_container<RR(T)>::value) {
+                if (type_info::is_plain<RR(typename T::value_type)>()) {                                                // one block
+                    return size + type_info::write_block(obj.data(), cnt, file);
+                }
+            }
+            for (const auto &i : obj) {
                 size += write_bin(i, file);
             }
             return size;
         } else if constexpr (std::is_class<RR(T)>::value) {                                                             // user defined class type
-            std::string typenm = type_info::demangle(T());
-            if (type_info::type_writer_bin.find(typenm) == type_info::type_writer_bin.end()) {
-                std::cerr << "type " << typenm << " not registered" << std::endl;
-                throw std::runtime_error("type not registered");
-            }
-            return type_info::type_writer_bin[typenm]((void *)&obj, file);
+            return type_info::dispatch<RR(T)>::writer_bin()((void *)&obj, file);
         } else {
             throw std::runtime_error("Unsupported type");
         }
         return 0;
     }
 
+    template<class T>
+    unsigned int read_bin(T &obj, std::istream& file);
+
+    // read one element and add it to the container
+    template<class T>
+    unsigned int read_element_(T &obj, std::istream& file) {
+        unsigned int size = 0;
+        if constexpr (my_type_traits::is_map<RR(T)>::value) {                                          // the containers have different insert operations
+            auto k = type_info::make_element<RR(typename T::key_type)>(type_info::allocator_of(obj));   // so I distinguish them with templates
+            auto v = type_info::make_element<RR(typename T::mapped_type)>(type_info::allocator_of(obj));
+            size += read_bin(k, file);
+            size += read_bin(v, file);
+            obj.emplace(std::move(k), std::move(v));
+        } else {
+            auto it = type_info::make_element<RR(typename T::value_type)>(type_info::allocator_of(obj));
+            size += read_bin(it, file);
+            if constexpr (my_type_traits::is_sequence_container<RR(T)>::value) {                        // sequence container type
+                obj.push_back(std::move(it));
+            } else if constexpr (my_type_traits::is_set<RR(T)>::value) {                                // set type
+                obj.insert(std::move(it));
+            } else {                                                                                    // container adaptor type
+                obj.push(std::move(it));
+            }
+        }
+        return size;
+    }
+
+    /**
+     * @brief read cnt elements and add them to the container
+     * @param obj
+     * @param cnt the number of elements
+     * @param file
+     * @return the input size of binary data
+     */
+    template<class T>
+    unsigned int read_elements(T &obj, unsigned int cnt, std::istream& file) {
+        if constexpr (type_info::packable<RR(T)>()) {
+            if (type_info::packed_keys) {                                                               // packed keys
+                return type_info::read_packed(obj, cnt, file, [&](auto &value) { return read_bin(value, file); });
+            }
+        }
+        if constexpr (my_type_traits::is_contiguous_container<RR(T)>::value) {
+            if (type_info::is_plain<RR(typename T::value_type)>()) {                                   // one block
+                return type_info::read_block(obj, cnt, file);
+            }
+        }
+        unsigned int size = 0;
+        for (unsigned int i = 0; i < cnt; ++ i) {
+            size += read_element_(obj, file);
+        }
+        return size;
+    }
+
     /**
      * @brief binary deserialization input
      * @param obj
@@ -83,87 +160,331 @@ namespace bin_srl {
      * @return the input size of binary data
      */
     template<class T>
-    unsigned int read_bin(T &obj, std::ifstream& file) {
+    unsigned int read_bin(T &obj, std::istream& file) {
+        type_info::identity_scope identity(!std::is_arithmetic<RR(T)>::value);
         if constexpr (std::is_arithmetic<RR(T)>::value) {
             file.read(reinterpret_cast<char *>(&obj), sizeof(T));
             return sizeof(T);
         } else if constexpr (my_type_traits::is_unique_ptr<RR(T)>::value) {
             obj = std::unique_ptr<typename T::element_type>(new typename T::element_type());
             return read_bin(*obj, file);
-        } else if constexpr (std::is_pointer<RR(T)>::value) {
+        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_shared_ptr<RR(T)>::value) {
             // memory leak!!!
-            obj = new typename std::remove_pointer<T>::type();
-            return read_bin(*obj, file);
+            unsigned int ref = 0, size = read_bin(ref, file);
+            if (ref == 0) {
+                obj = nullptr;
+            } else if (ref == type_info::next_read_id<RR(T)>()) {                                      // a new object
+                auto target = type_info::track_new<RR(T)>();
+                obj = target;
+                size += read_bin(*target, file);
+            } else {                                                                                    // one read before
+                obj = type_info::tracked<RR(T)>(ref);
+            }
+            return size;
         } else if constexpr (std::is_array<RR(T)>::value) {
+            if (type_info::is_plain<RR(T)>()) {                                                         // one block
+                file.read(reinterpret_cast<char *>(&obj), sizeof(obj));
+                return sizeof(obj);
+            }
             unsigned int size = 0;
             for (int i = 0; i < (int)std::extent<RR(T)>::value; ++ i) {
                 size += read_bin(obj[i], file);
             }
             return size;
-        } else if constexpr (std::is_same<RR(T), std::string>::value) {
+        } else if constexpr (my_type_traits::is_string<RR(T)>::value) {
+            if (type_info::string_dictionary) {
+                return type_info::read_dictionary_string(obj, file);
+            }
             unsigned int size = 0, len = 0;
             size += read_bin(len, file);
-            obj = "";
-            for (int i = 0; i < len; ++ i) {
-                char ch = 0;
-                size += read_bin(ch, file);
-                obj += ch;
-            }
-            return size;
+            obj.resize(len);
+            file.read(&obj[0], len);
+            return size + len;
         } else if constexpr (my_type_traits::is_pair<RR(T)>::value) {
             unsigned int size = 0;
             size += read_bin(obj.first, file);
-            size += read_bin(obj.second, file);                                                         // the containers have different insert operations
-            return size;                                                                                // so I distinguish them with templates
-        } else if constexpr (my_type_traits::is_sequence_container<RR(T)>::value) {                     // sequence container type
+            size += read_bin(obj.second, file);
+            return size;
+        } else if constexpr (my_type_traits::is_container<RR(T)>::value ||
+                             my_type_traits::is_container_adaptor<RR(T)>::value) {                     // container type
             unsigned int size = 0, cnt = 0;
             size += read_bin(cnt, file);
-            for (unsigned int i = 0; i < cnt; ++ i) {
-                typename std::remove_cv<typename T::value_type>::type it;
-                size += read_bin(it, file);
-                obj.push_back(it);
+            return size + read_elements(obj, cnt, file);
+        } else if constexpr (std::is_class<RR(T)>::value) {
+            return type_info::dispatch<RR(T)>::reader_bin()((void *)&obj, file);
+        } else {
+            throw std::runtime_error("Unsupported type");
+        }
+        return 0;
+    }
+
+    /**
+     * @brief the number of bytes write_bin produces for every value of a T
+     * @return the size, 0 if it depends on the value
+     */
+    template<class T>
+    constexpr size_t fixed_size() {
+        if constexpr (std::is_arithmetic<T>::value) {
+            return sizeof(T);
+        } else if constexpr (std::is_array<T>::value) {
+            return std::extent<T>::value * fixed_size<RR(typename std::remove_extent<T>::type)>();
+        } else if constexpr (my_type_traits::is_pair<T>::value) {
+            constexpr size_t first = fixed_size<RR(typename T::first_type)>();
+            constexpr size_t second = fixed_size<RR(typename T::second_type)>();
+            return first != 0 && second != 0 ? first + second : 0;
+        } else {
+            return 0;                                                                                   // registered structs are only known at run time
+        }
+    }
+
+    /**
+     * @brief the exact number of bytes write_bin produces for obj, without producing them
+     * Fixed size types are known at compile time, strings and containers of
+     * fixed size elements in constant time, everything else by a traversal
+     * that only counts.
+     * @param obj
+     * @return the output size of binary data
+     */
+    template<class T>
+    size_t serialized_size(const T& obj) {
+        type_info::identity_scope identity(fixed_size<RR(T)>() == 0);
+        if constexpr (fixed_size<RR(T)>() != 0) {
+            return fixed_size<RR(T)>();
+        } else if constexpr (my_type_traits::is_unique_ptr<RR(T)>::value) {
+            return serialized_size(*obj);
+        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_shared_ptr<RR(T)>::value) {
+            unsigned int ref = 0;
+            return sizeof(unsigned int) + (type_info::track_written(obj, ref) ? serialized_size(*obj) : 0);
+        } else if constexpr (std::is_array<RR(T)>::value) {
+            size_t size = 0;
+            for (size_t i = 0; i < std::extent<RR(T)>::value; ++ i) {
+                size += serialized_size(obj[i]);
             }
             return size;
-        } else if constexpr (my_type_traits::is_set<RR(T)>::value) {                                    // set type
-            unsigned int size = 0, cnt = 0;
-            size += read_bin(cnt, file);
-            for (unsigned int i = 0; i < cnt; ++ i) {
-                typename std::remove_cv<typename T::value_type>::type it;
-                size += read_bin(it, file);
-                obj.insert(it);
+        } else if constexpr (my_type_traits::is_string<RR(T)>::value) {
+            if (type_info::string_dictionary) {
+                return type_info::dictionary_string_size(obj);
+            }
+            return sizeof(unsigned int) + obj.length();
+        } else if constexpr (my_type_traits::is_pair<RR(T)>::value) {
+            return serialized_size(obj.first) + serialized_size(obj.second);
+        } else if constexpr (my_type_traits::is_container<RR(T)>::value) {
+            typedef RR(typename T::value_type) value_type;
+            if constexpr (type_info::packable<RR(T)>()) {
+                if (type_info::packed_keys) {
+                    size_t bytes = 0;
+                    size_t size = sizeof(unsigned int) + 1 + (type_info::keys_delta_smaller(obj, bytes) ?
+                                  sizeof(unsigned int) + bytes : obj.size() * sizeof(typename T::key_type));
+                    if constexpr (my_type_traits::is_map<RR(T)>::value) {
+                        for (const auto &i : obj) {
+                            size += serialized_size(i.second);
+                        }
+                    }
+                    return size;
+                }
+            }
+            if constexpr (fixed_size<value_type>() != 0) {
+                return sizeof(unsigned int) + obj.size() * fixed_size<value_type>();
+            } else {
+                if (type_info::is_plain<value_type>()) {
+                    return sizeof(unsigned int) + obj.size() * sizeof(value_type);
+                }
+                size_t size = sizeof(unsigned int);
+                for (const auto &i : obj) {
+                    size += serialized_size(i);
+                }
+                return size;
+            }
+        } else if constexpr (std::is_class<RR(T)>::value) {
+            const type_info::typeInfo &info = type_info::dispatch<RR(T)>::info();
+            if (info.plain) {
+                return sizeof(T);
+            }
+            size_t size = 0;
+            for (const auto &member : info.members) {
+                size += member.sizer_bin(reinterpret_cast<const char *>(&obj) + member.offset);
             }
             return size;
-        } else if constexpr (my_type_traits::is_map<RR(T)>::value) {                                    // map type
-            unsigned int size = 0, cnt = 0;
-            size += read_bin(cnt, file);
-            for (unsigned int i = 0; i < cnt; ++ i) {
-                typename std::remove_cv<typename T::key_type>::type k;
-                typename std::remove_cv<typename T::mapped_type>::type v;
-                size += read_bin(k, file);
-                size += read_bin(v, file);
-                obj.insert(std::make_pair(k, v));
+        } else {
+            throw std::runtime_error("Unsupported type");
+        }
+    }
+
+    // pass over n bytes of the input, seeking when the stream can
+    inline void skip_bytes_(std::istream &file, size_t n) {
+        if (n == 0) return;
+        if (file.rdbuf()->pubseekoff((std::streamoff)n, std::ios::cur, std::ios::in) == std::streampos(std::streamoff(-1))) {
+            file.ignore((std::streamsize)n);
+        }
+    }
+
+    // the bytes left in the stream, UINT64_MAX when its length can't be told
+    inline uint64_t bytes_left_(std::istream &file) {
+        std::streampos here = file.tellg();
+        if (here == std::streampos(-1)) return UINT64_MAX;
+        file.seekg(0, std::ios::end);
+        std::streampos end = file.tellg();
+        file.seekg(here);
+        if (end == std::streampos(-1) || end < here) return UINT64_MAX;
+        return (uint64_t)(end - here);
+    }
+
+    /**
+     * @brief pass over a T written by write_bin, without building it
+     * Strings and containers of fixed size elements are passed over in one
+     * step, everything else by a traversal that only reads lengths.
+     * @param file
+     * @return the input size of binary data passed over
+     */
+    template<class T>
+    size_t skip_bin(std::istream& file) {
+        type_info::identity_scope identity(fixed_size<RR(T)>() == 0);
+        if constexpr (fixed_size<RR(T)>() != 0) {
+            skip_bytes_(file, fixed_size<RR(T)>());
+            return fixed_size<RR(T)>();
+        } else if constexpr (my_type_traits::is_unique_ptr<RR(T)>::value) {
+            return skip_bin<typename T::element_type>(file);
+        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_shared_ptr<RR(T)>::value) {
+            unsigned int ref = 0;
+            size_t size = read_bin(ref, file);
+            if (ref != 0 && ref == type_info::next_read_id<RR(T)>()) {                                  // a new object
+                type_info::track_skipped<RR(T)>();
+                size += skip_bin<type_info::target_of<RR(T)>>(file);
             }
             return size;
-        } else if constexpr (my_type_traits::is_container_adaptor<RR(T)>::value) {                      // container adaptor type
-            unsigned int size = 0, cnt = 0;
-            size += read_bin(cnt, file);
+        } else if constexpr (std::is_array<RR(T)>::value) {
+            typedef RR(typename std::remove_extent<RR(T)>::type) value_type;
+            if (type_info::is_plain<value_type>()) {
+                skip_bytes_(file, sizeof(T));
+                return sizeof(T);
+            }
+            size_t size = 0;
+            for (size_t i = 0; i < std::extent<RR(T)>::value; ++ i) {
+                size += skip_bin<value_type>(file);
+            }
+            return size;
+        } else if constexpr (my_type_traits::is_string<RR(T)>::value) {
+            if (type_info::string_dictionary) {                                                         // later strings may refer to it
+                std::string str;
+                return type_info::read_dictionary_string(str, file);
+            }
+            unsigned int len = 0;
+            read_bin(len, file);
+            skip_bytes_(file, len);
+            return sizeof(unsigned int) + len;
+        } else if constexpr (my_type_traits::is_pair<RR(T)>::value) {
+            size_t size = skip_bin<RR(typename T::first_type)>(file);
+            return size + skip_bin<RR(typename T::second_type)>(file);
+        } else if constexpr (my_type_traits::is_container<RR(T)>::value ||
+                             my_type_traits::is_container_adaptor<RR(T)>::value) {
+            typedef my_type_traits::mutable_value_t<typename T::value_type> value_type;
+            unsigned int cnt = 0;
+            size_t size = read_bin(cnt, file);
+            if constexpr (type_info::packable<RR(T)>()) {
+                if (type_info::packed_keys) {
+                    typedef RR(typename T::key_type) key_type;
+                    int layout = file.get();
+                    size += 1;
+                    if (layout == type_info::keys_delta) {                                              // the keys are one run
+                        unsigned int len = 0;
+                        size += read_bin(len, file);
+                        skip_bytes_(file, len);
+                        size += len;
+                    } else if (layout != type_info::keys_plain) {
+                        type_info::packed_keys_error_();
+                    } else if constexpr (!my_type_traits::is_map<RR(T)>::value) {
+                        skip_bytes_(file, sizeof(key_type) * cnt);
+                        size += sizeof(key_type) * cnt;
+                    }
+                    if constexpr (my_type_traits::is_map<RR(T)>::value) {
+                        for (unsigned int i = 0; i < cnt; ++ i) {
+                            if (layout == type_info::keys_plain) {
+                                skip_bytes_(file, sizeof(key_type));
+                                size += sizeof(key_type);
+                            }
+                            size += skip_bin<RR(typename T::mapped_type)>(file);
+                        }
+                    }
+                    return size;
+                }
+            }
+            size_t each = fixed_size<value_type>();
+            if (each == 0 && type_info::is_plain<value_type>()) {
+                each = sizeof(value_type);
+            }
+            if (each != 0) {
+                skip_bytes_(file, each * cnt);
+                return size + each * cnt;
+            }
             for (unsigned int i = 0; i < cnt; ++ i) {
-                typename std::remove_cv<typename T::value_type>::type it;
-                size += read_bin(it, file);
-                obj.push(it);
+                size += skip_bin<value_type>(file);
             }
             return size;
         } else if constexpr (std::is_class<RR(T)>::value) {
-            std::string typenm = type_info::demangle(T());
-            if (type_info::type_reader_bin.find(typenm) == type_info::type_reader_bin.end()) {
-                std::cerr << "type " << typenm << " not registered" << std::endl;
-                throw std::runtime_error("type not registered");
+            const type_info::typeInfo &info = type_info::dispatch<RR(T)>::info();
+            if (info.plain) {
+                skip_bytes_(file, sizeof(T));
+                return sizeof(T);
             }
-            return type_info::type_reader_bin[typenm]((void *)&obj, file);
+            size_t size = 0;
+            for (const auto &member : info.members) {
+                size += member.skipper_bin(file);
+            }
+            return size;
         } else {
             throw std::runtime_error("Unsupported type");
         }
-        return 0;
+    }
+
+    /**
+     * @brief a stream buffer over a fixed block of memory, reading or writing past its end fails the stream
+     */
+    class block_buf : public std::streambuf {
+    public:
+        block_buf(char *data, size_t size) {
+            setp(data, data + size);
+            setg(data, data, data + size);
+        }
+        size_t written() const {
+            return pptr() - pbase();
+        }
+    };
+
+    /**
+     * @brief binary serialization into memory, the buffer is allocated once with the exact size
+     * @param obj
+     * @param buf replaced by the binary data
+     * @return the output size of binary data
+     */
+    template<class T>
+    size_t serialize_buffer(const T& obj, std::string &buf) {
+        buf.resize(serialized_size(obj));
+        block_buf out_buf(&buf[0], buf.size());
+        std::ostream out(&out_buf);
+        write_bin(obj, out);
+        if (!out || out_buf.written() != buf.size()) {
+            std::cerr << "Serialized size mismatch" << std::endl;
+            throw std::runtime_error("Serialized size mismatch");
+        }
+        return buf.size();
+    }
+
+    /**
+     * @brief binary deserialization from memory
+     * @param obj
+     * @param buf the binary data
+     * @return the input size of binary data
+     */
+    template<class T>
+    size_t deserialize_buffer(T &obj, const std::string &buf) {
+        block_buf in_buf(const_cast<char *>(buf.data()), buf.size());                  // only read from
+        std::istream in(&in_buf);
+        size_t size = read_bin(obj, in);
+        if (!in) {
+            std::cerr << "Error reading buffer" << std::endl;
+            throw std::runtime_error("Error reading buffer");
+        }
+        return size;
     }
 
     /**
@@ -202,4 +523,1392 @@ namespace bin_srl {
         file.close();
         return size;
     }
+
+    /**
+     * @brief binary deserialization input entry function, reading into a memory resource
+     * The objects raw pointers point to are allocated from resource and are
+     * not to be deleted. The elements of std::pmr containers are built with
+     * the allocator of their container, so when the containers of obj use
+     * resource as well, the whole object lives in it and is released with it.
+     * @param obj
+     * @param file_name
+     * @param resource
+     * @return the input size of binary data
+     */
+    template<class T>
+    unsigned int deserialize(T &obj, const char *file_name, std::pmr::memory_resource *resource) {
+        type_info::resource_scope scope(resource);
+        return deserialize(obj, file_name);
+    }
+
+    /**
+     * @brief binary serialization output entry function, with the keys of ordered sets and maps of integers packed
+     * Each such container gets a layout byte after its count. Its keys are
+     * written as the zigzag varint steps from one to the next when that is
+     * smaller than writing them in full, which it is for sorted dense ids.
+     * @param obj
+     * @param file_name
+     * @return the output size of binary data
+     */
+    template<class T>
+    unsigned int serialize_packed(const T& obj, const char *file_name) {
+        type_info::packed_scope scope;
+        return serialize(obj, file_name);
+    }
+
+    /**
+     * @brief binary deserialization input entry function for files written by serialize_packed
+     * @param obj
+     * @param file_name
+     * @return the input size of binary data
+     */
+    template<class T>
+    unsigned int deserialize_packed(T &obj, const char *file_name) {
+        type_info::packed_scope scope;
+        return deserialize(obj, file_name);
+    }
+
+    /**
+     * @brief binary serialization output entry function, with the strings written through a dictionary
+     * A string met for the first time is written after a new id, later
+     * equal strings, map keys and labels alike, as the id alone.
+     * @param obj
+     * @param file_name
+     * @return the output size of binary data
+     */
+    template<class T>
+    unsigned int serialize_dictionary(const T& obj, const char *file_name) {
+        type_info::dictionary_scope scope;
+        return serialize(obj, file_name);
+    }
+
+    /**
+     * @brief binary deserialization input entry function for files written by serialize_dictionary
+     * Every distinct string is read from the file once.
+     * @param obj
+     * @param file_name
+     * @return the input size of binary data
+     */
+    template<class T>
+    unsigned int deserialize_dictionary(T &obj, const char *file_name) {
+        type_info::dictionary_scope scope;
+        return deserialize(obj, file_name);
+    }
+
+    // the size of a member in the indexed encoding
+    inline uint64_t indexed_size_(const void *obj, const type_info::typeInfo &info);
+    inline uint64_t indexed_member_size_(const void *obj, const type_info::memberPair &member) {
+        const char *dat = reinterpret_cast<const char *>(obj) + member.offset;
+        const type_info::typeInfo *sub = type_info::typeInfo_map.find(member.typenm);
+        return sub != nullptr ? indexed_size_(dat, *sub) : member.sizer_bin(dat);
+    }
+
+    // the size of a registered struct in the indexed encoding
+    inline uint64_t indexed_size_(const void *obj, const type_info::typeInfo &info) {
+        uint64_t size = sizeof(unsigned int) + info.members.size() * sizeof(uint64_t);
+        for (const auto &member : info.members) {
+            size += indexed_member_size_(obj, member);
+        }
+        return size;
+    }
+
+    /**
+     * @brief write a registered struct in the indexed encoding
+     * The member count comes first, then the end of every member relative
+     * to the end of this table, then the members. Registered struct members
+     * are written the same way, the others as write_bin writes them.
+     * @param obj
+     * @param info
+     * @param file
+     * @return the output size of binary data
+     */
+    inline uint64_t write_indexed_(const void *obj, const type_info::typeInfo &info, std::ostream &file) {
+        unsigned int count = (unsigned int)info.members.size();
+        std::vector<uint64_t> ends;
+        ends.reserve(count);
+        uint64_t end = 0;
+        for (const auto &member : info.members) {
+            end += indexed_member_size_(obj, member);
+            ends.push_back(end);
+        }
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char *>(ends.data()), count * sizeof(uint64_t));
+        for (const auto &member : info.members) {
+            const char *dat = reinterpret_cast<const char *>(obj) + member.offset;
+            const type_info::typeInfo *sub = type_info::typeInfo_map.find(member.typenm);
+            if (sub != nullptr) {
+                write_indexed_(dat, *sub, file);
+            } else {
+                member.writer_bin(dat, file);
+            }
+        }
+        return sizeof(count) + count * sizeof(uint64_t) + end;
+    }
+
+    // read the member table of a registered struct in the indexed encoding
+    inline void read_index_(const type_info::typeInfo &info, std::istream &file, std::vector<uint64_t> &ends) {
+        unsigned int count = 0;
+        file.read(reinterpret_cast<char *>(&count), sizeof(count));
+        if (!file || count != info.members.size()) {
+            std::cerr << "Indexed layout mismatch of " << info.name << std::endl;
+            throw std::runtime_error("Indexed layout mismatch");
+        }
+        ends.resize(count);
+        file.read(reinterpret_cast<char *>(ends.data()), count * sizeof(uint64_t));
+    }
+
+    // read a registered struct in the indexed encoding
+    inline uint64_t read_indexed_(void *obj, const type_info::typeInfo &info, std::istream &file) {
+        std::vector<uint64_t> ends;
+        read_index_(info, file, ends);
+        for (const auto &member : info.members) {
+            char *dat = reinterpret_cast<char *>(obj) + member.offset;
+            const type_info::typeInfo *sub = type_info::typeInfo_map.find(member.typenm);
+            if (sub != nullptr) {
+                read_indexed_(dat, *sub, file);
+            } else {
+                member.reader_bin(dat, file);
+            }
+        }
+        return sizeof(unsigned int) + ends.size() * sizeof(uint64_t) + (ends.empty() ? 0 : ends.back());
+    }
+
+    /**
+     * @brief binary serialization of a registered struct in the indexed encoding
+     * Every registered struct, the outer one and those it holds as members,
+     * is prefixed with a table of where its members end, so read_member can
+     * seek straight to one of them. Each member is written on its own, so
+     * pointers keep their identity within a member but not across members.
+     * @param obj
+     * @param file_name
+     * @return the output size of binary data
+     */
+    template<class T>
+    uint64_t serialize_indexed(const T& obj, const char *file_name) {
+        std::ofstream file(file_name, std::ios::binary | std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        uint64_t size = write_indexed_(&obj, type_info::dispatch<RR(T)>::info(), file);
+        if (!file) {
+            std::cerr << "Error writing file: " << file_name << std::endl;
+            throw std::runtime_error("Error writing file");
+        }
+        return size;
+    }
+
+    /**
+     * @brief binary deserialization of a registered struct written by serialize_indexed
+     * @param obj
+     * @param file_name
+     * @return the input size of binary data
+     */
+    template<class T>
+    uint64_t deserialize_indexed(T &obj, const char *file_name) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        return read_indexed_(&obj, type_info::dispatch<RR(T)>::info(), file);
+    }
+
+    /**
+     * @brief read one member of a registered struct written by serialize_indexed
+     * Only the member tables on the way and the member itself are read.
+     * @param file_name
+     * @param path the names of the members from the outer struct down, joined by '.'
+     * @param value of the type of the member
+     * @return the input size of the member
+     */
+    template<class T, class V>
+    uint64_t read_member(const char *file_name, const std::string &path, V &value) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        const type_info::typeInfo *info = &type_info::dispatch<RR(T)>::info();
+        std::vector<uint64_t> ends;
+        uint64_t base = 0;
+        for (size_t first = 0; ; ) {
+            size_t last = std::min(path.find('.', first), path.size());
+            std::string name = path.substr(first, last - first);
+            auto member = std::find_if(info->members.begin(), info->members.end(),
+                                       [&](const type_info::memberPair &m) { return m.name == name; });
+            if (member == info->members.end()) {
+                std::cerr << "No member " << name << " in " << info->name << std::endl;
+                throw std::runtime_error("No such member");
+            }
+            file.seekg(base);
+            read_index_(*info, file, ends);
+            size_t k = member - info->members.begin();
+            base += sizeof(unsigned int) + ends.size() * sizeof(uint64_t) + (k == 0 ? 0 : ends[k - 1]);
+            const type_info::typeInfo *sub = type_info::typeInfo_map.find(member->typenm);
+            if (last == path.size()) {
+                if (member->typenm != type_info::dispatch<RR(V)>::type_name()) {
+                    std::cerr << "Member " << path << " is a " << member->typenm << std::endl;
+                    throw std::runtime_error("Member type mismatch");
+                }
+                file.seekg(base);
+                uint64_t size = sub != nullptr ? read_indexed_(&value, *sub, file) : member->reader_bin(&value, file);
+                if (!file) {
+                    std::cerr << "Error reading member " << path << " of " << file_name << std::endl;
+                    throw std::runtime_error("Error reading member");
+                }
+                return size;
+            }
+            if (sub == nullptr) {
+                std::cerr << "Member " << name << " of " << info->name << " is not a registered struct" << std::endl;
+                throw std::runtime_error("Not a registered struct");
+            }
+            info = sub;
+            first = last + 1;
+        }
+    }
+
+    // read the members of a registered struct a projection wants, skip the others
+    inline size_t read_projected_(void *obj, const type_info::typeInfo &info, const std::vector<std::string> &paths, std::istream &file) {
+        type_info::check_projection(paths, info);
+        size_t size = 0;
+        std::vector<std::string> sub;
+        for (const auto &member : info.members) {
+            char *dat = reinterpret_cast<char *>(obj) + member.offset;
+            if (type_info::project_member(paths, member.name, sub)) {
+                size += member.reader_bin(dat, file);
+            } else if (!sub.empty()) {
+                const type_info::typeInfo *inner = type_info::typeInfo_map.find(member.typenm);
+                if (inner == nullptr) {
+                    std::cerr << "Member " << member.name << " of " << info.name << " is not a registered struct" << std::endl;
+                    throw std::runtime_error("Not a registered struct");
+                }
+                size += read_projected_(dat, *inner, sub, file);
+            } else {
+                size += member.skipper_bin(file);
+            }
+        }
+        return size;
+    }
+
+    /**
+     * @brief binary deserialization of some members of a registered struct
+     * The members not named are passed over without being built and keep
+     * their values. Pointers into a member passed over can't be followed
+     * from the members read, which throws.
+     * @param obj
+     * @param file_name
+     * @param members the names of the members to read, a member of a member as "inner.name"
+     * @return the input size of binary data, including the data passed over
+     */
+    template<class T>
+    unsigned int deserialize_projection(T &obj, const char *file_name, const std::vector<std::string> &members) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        type_info::identity_scope identity;
+        unsigned int size = read_projected_(&obj, type_info::dispatch<RR(T)>::info(), members, file);
+        if (!file) {
+            std::cerr << "Error reading file: " << file_name << std::endl;
+            throw std::runtime_error("Error reading file");
+        }
+        return size;
+    }
+
+    // one column of the columnar encoding, a member reached from the row through registered structs
+    struct column_ {
+        std::string path;
+        size_t offset;
+        const type_info::memberPair *member;
+    };
+
+    // the columns of a registered struct, its registered struct members that are not plain are split into theirs
+    inline void columns_(const type_info::typeInfo &info, const std::string &prefix, size_t offset, std::vector<column_> &columns) {
+        for (const auto &member : info.members) {
+            const type_info::typeInfo *sub = type_info::typeInfo_map.find(member.typenm);
+            if (sub != nullptr && !sub->plain) {
+                columns_(*sub, prefix + member.name + ".", offset + member.offset, columns);
+            } else {
+                columns.push_back({prefix + member.name, offset + member.offset, &member});
+            }
+        }
+    }
+
+    /**
+     * @brief write a vector of a registered struct in the columnar encoding
+     * The row count and the column count come first, then every column
+     * prefixed with its size in bytes. A plain member is a column of its
+     * values back to back, any other member a column of its write_bin
+     * encodings, so a string column is its lengths and bytes in turn.
+     * @param obj
+     * @param file
+     * @return the output size of binary data
+     */
+    template<class T>
+    uint64_t write_columnar(const T& obj, std::ostream& file) {
+        static_assert(my_type_traits::is_contiguous_container<RR(T)>::value, "columnar encoding needs a vector");
+        typedef RR(typename T::value_type) row_type;
+        std::vector<column_> columns;
+        columns_(type_info::dispatch<row_type>::info(), "", 0, columns);
+        unsigned int rows = (unsigned int)obj.size(), count = (unsigned int)columns.size();
+        file.write(reinterpret_cast<const char *>(&rows), sizeof(rows));
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        uint64_t size = sizeof(rows) + sizeof(count);
+        type_info::identity_scope identity;
+        const char *base = reinterpret_cast<const char *>(obj.data());
+        std::string buf;
+        for (const auto &column : columns) {
+            const type_info::memberPair &member = *column.member;
+            if (member.plain) {                                                             // gathered into one block
+                buf.resize((size_t)rows * member.size);
+                for (unsigned int i = 0; i < rows; ++ i) {
+                    memcpy(&buf[(size_t)i * member.size], base + (size_t)i * sizeof(row_type) + column.offset, member.size);
+                }
+            } else {
+                std::ostringstream out(std::ios::binary);
+                for (unsigned int i = 0; i < rows; ++ i) {
+                    member.writer_bin(base + (size_t)i * sizeof(row_type) + column.offset, out);
+                }
+                buf = out.str();
+            }
+            uint64_t len = buf.size();
+            file.write(reinterpret_cast<const char *>(&len), sizeof(len));
+            file.write(buf.data(), len);
+            size += sizeof(len) + len;
+        }
+        return size;
+    }
+
+    // read one column of the columnar encoding into the rows
+    inline void read_column_(char *base, size_t stride, unsigned int rows, const column_ &column, uint64_t len, std::istream &file) {
+        const type_info::memberPair &member = *column.member;
+        uint64_t size = 0;
+        if (member.plain) {                                                                 // scattered from one block
+            size = (uint64_t)rows * member.size;
+            if (size == len) {
+                std::string buf(len, '\0');
+                file.read(&buf[0], len);
+                for (unsigned int i = 0; i < rows; ++ i) {
+                    memcpy(base + (size_t)i * stride + column.offset, &buf[(size_t)i * member.size], member.size);
+                }
+            }
+        } else {
+            for (unsigned int i = 0; i < rows && file; ++ i) {
+                size += member.reader_bin(base + (size_t)i * stride + column.offset, file);
+            }
+        }
+        if (!file || size != len) {
+            std::cerr << "Column " << column.path << " is damaged" << std::endl;
+            throw std::runtime_error("Column size mismatch");
+        }
+    }
+
+    // read the row and column counts of the columnar encoding, every row takes at least a byte of what is left
+    inline unsigned int read_columnar_header_(size_t columns, std::istream &file) {
+        unsigned int rows = 0, count = 0;
+        file.read(reinterpret_cast<char *>(&rows), sizeof(rows));
+        file.read(reinterpret_cast<char *>(&count), sizeof(count));
+        if (!file || count != columns) {
+            std::cerr << "Columnar layout mismatch" << std::endl;
+            throw std::runtime_error("Columnar layout mismatch");
+        }
+        uint64_t left = bytes_left_(file);
+        if (rows > 0 && (columns == 0 || left < columns * sizeof(uint64_t) || rows > left - columns * sizeof(uint64_t))) {
+            std::cerr << "Columnar row count " << rows << " exceeds the data" << std::endl;
+            throw std::runtime_error("Columnar row count mismatch");
+        }
+        return rows;
+    }
+
+    // a column of len bytes holds at least a byte per row, a plain one exactly its size per row
+    inline void check_column_rows_(unsigned int rows, const column_ &column, uint64_t len) {
+        const type_info::memberPair &member = *column.member;
+        if (member.plain ? (uint64_t)rows * member.size != len : rows > len) {
+            std::cerr << "Column " << column.path << " is damaged" << std::endl;
+            throw std::runtime_error("Column size mismatch");
+        }
+    }
+
+    /**
+     * @brief read a vector of a registered struct written by write_columnar
+     * @param obj replaced by the rows
+     * @param file
+     * @return the input size of binary data
+     */
+    template<class T>
+    uint64_t read_columnar(T &obj, std::istream& file) {
+        static_assert(my_type_traits::is_contiguous_container<RR(T)>::value, "columnar encoding needs a vector");
+        typedef RR(typename T::value_type) row_type;
+        std::vector<column_> columns;
+        columns_(type_info::dispatch<row_type>::info(), "", 0, columns);
+        unsigned int rows = read_columnar_header_(columns.size(), file);
+        obj.clear();
+        obj.resize(rows);
+        uint64_t size = 2 * sizeof(unsigned int);
+        type_info::identity_scope identity;
+        for (const auto &column : columns) {
+            uint64_t len = 0;
+            file.read(reinterpret_cast<char *>(&len), sizeof(len));
+            read_column_(reinterpret_cast<char *>(obj.data()), sizeof(row_type), rows, column, len, file);
+            size += sizeof(len) + len;
+        }
+        return size;
+    }
+
+    /**
+     * @brief binary serialization output entry function of a vector of a registered struct, in columns
+     * @param obj
+     * @param file_name
+     * @return the output size of binary data
+     */
+    template<class T>
+    uint64_t serialize_columnar(const T& obj, const char *file_name) {
+        std::ofstream file(file_name, std::ios::binary | std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        uint64_t size = write_columnar(obj, file);
+        if (!file) {
+            std::cerr << "Error writing file: " << file_name << std::endl;
+            throw std::runtime_error("Error writing file");
+        }
+        return size;
+    }
+
+    /**
+     * @brief binary deserialization input entry function for files written by serialize_columnar
+     * @param obj
+     * @param file_name
+     * @return the input size of binary data
+     */
+    template<class T>
+    uint64_t deserialize_columnar(T &obj, const char *file_name) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        return read_columnar(obj, file);
+    }
+
+    /**
+     * @brief read one column of a file written by serialize_columnar
+     * The columns before it are passed over with a seek. Pointers in the
+     * column to objects first written in an earlier column can't be
+     * followed, which throws.
+     * @param file_name
+     * @param path the names of the members from the row down, joined by '.'
+     * @param values replaced by the values of the member, one per row
+     * @return the input size of the column
+     */
+    template<class T, class V>
+    uint64_t read_column(const char *file_name, const std::string &path, std::vector<V> &values) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        std::vector<column_> columns;
+        columns_(type_info::dispatch<RR(T)>::info(), "", 0, columns);
+        auto column = std::find_if(columns.begin(), columns.end(), [&](const column_ &c) { return c.path == path; });
+        if (column == columns.end()) {
+            std::cerr << "No column " << path << " in " << type_info::dispatch<RR(T)>::info().name << std::endl;
+            throw std::runtime_error("No such column");
+        }
+        if (column->member->typenm != type_info::dispatch<RR(V)>::type_name()) {
+            std::cerr << "Column " << path << " is a " << column->member->typenm << std::endl;
+            throw std::runtime_error("Column type mismatch");
+        }
+        unsigned int rows = read_columnar_header_(columns.size(), file);
+        uint64_t len = 0;
+        for (auto it = columns.begin(); ; ++ it) {
+            file.read(reinterpret_cast<char *>(&len), sizeof(len));
+            if (it == column) break;
+            skip_bytes_(file, len);
+        }
+        column_ own = {path, 0, column->member};                                            // the values are the rows now
+        if (!file || len > bytes_left_(file)) {
+            std::cerr << "Column " << path << " is damaged" << std::endl;
+            throw std::runtime_error("Column size mismatch");
+        }
+        check_column_rows_(rows, own, len);
+        values.clear();
+        values.resize(rows);
+        type_info::identity_scope identity;
+        read_column_(reinterpret_cast<char *>(values.data()), sizeof(V), rows, own, len, file);
+        return len;
+    }
+
+    /**
+     * @brief the binary encoding of a registered struct, kept up to date member by member
+     * Every member is encoded on its own into one buffer, which is what
+     * serialize writes unless pointers are shared across members. update()
+     * encodes the members again, rewrites the changed ones in the buffer and
+     * lists them in a patch, so a copy of the buffer taken earlier is
+     * brought up to date by apply_patch() with only the changes.
+     */
+    template<class T>
+    class checkpoint {
+    public:
+        explicit checkpoint(const T &obj) : info_(type_info::dispatch<RR(T)>::info()) {
+            for (size_t k = 0; k < info_.members.size(); ++ k) {
+                encode_(obj, k);
+                data_ += scratch_;
+                ends_.push_back(data_.size());
+            }
+        }
+
+        // the encoding of the object as of the last update
+        const std::string &data() const {
+            return data_;
+        }
+
+        /**
+         * @brief bring the encoding up to date with obj
+         * @param obj
+         * @param patch replaced by the changes
+         * @return the number of members that changed
+         */
+        size_t update(const T &obj, std::string &patch) {
+            std::vector<size_t> members(info_.members.size());
+            for (size_t k = 0; k < members.size(); ++ k) {
+                members[k] = k;
+            }
+            return update_(obj, members, patch);
+        }
+
+        /**
+         * @brief bring the encoding up to date with obj, which only changed in the named members
+         * Only those members are encoded again.
+         * @param obj
+         * @param dirty the names of the members that may have changed, "inner.name" marks all of inner
+         * @param patch replaced by the changes
+         * @return the number of members that changed
+         */
+        size_t update(const T &obj, const std::vector<std::string> &dirty, std::string &patch) {
+            type_info::check_projection(dirty, info_);
+            std::vector<size_t> members;
+            std::vector<std::string> sub;
+            for (size_t k = 0; k < info_.members.size(); ++ k) {
+                if (type_info::project_member(dirty, info_.members[k].name, sub) || !sub.empty()) {
+                    members.push_back(k);
+                }
+            }
+            return update_(obj, members, patch);
+        }
+
+    private:
+        // encode member k of obj into scratch_
+        void encode_(const T &obj, size_t k) {
+            const type_info::memberPair &member = info_.members[k];
+            const char *dat = reinterpret_cast<const char *>(&obj) + member.offset;
+            scratch_.resize(member.sizer_bin(dat));
+            block_buf out_buf(&scratch_[0], scratch_.size());
+            std::ostream out(&out_buf);
+            type_info::identity_scope identity;
+            member.writer_bin(dat, out);
+            if (!out || out_buf.written() != scratch_.size()) {
+                std::cerr << "Serialized size mismatch of " << member.name << std::endl;
+                throw std::runtime_error("Serialized size mismatch");
+            }
+        }
+
+        // encode the members again in order, a change is the member index, its offset, its old and new sizes and its bytes
+        size_t update_(const T &obj, const std::vector<size_t> &members, std::string &patch) {
+            unsigned int changed = 0;
+            patch.assign(sizeof(changed), '\0');
+            for (size_t k : members) {
+                encode_(obj, k);
+                uint64_t begin = k == 0 ? 0 : ends_[k - 1], old = ends_[k] - begin, len = scratch_.size();
+                if (old == len && data_.compare(begin, old, scratch_) == 0) {
+                    continue;
+                }
+                unsigned int index = (unsigned int)k;
+                patch.append(reinterpret_cast<const char *>(&index), sizeof(index));
+                patch.append(reinterpret_cast<const char *>(&begin), sizeof(begin));
+                patch.append(reinterpret_cast<const char *>(&old), sizeof(old));
+                patch.append(reinterpret_cast<const char *>(&len), sizeof(len));
+                patch += scratch_;
+                data_.replace(begin, old, scratch_);                                    // in place when the size is the same
+                for (size_t j = k; j < ends_.size(); ++ j) {
+                    ends_[j] = ends_[j] - old + len;
+                }
+                ++ changed;
+            }
+            memcpy(&patch[0], &changed, sizeof(changed));
+            return changed;
+        }
+
+        const type_info::typeInfo &info_;
+        std::string data_;
+        std::vector<size_t> ends_;                                                      // where every member ends in data_
+        std::string scratch_;
+    };
+
+    /**
+     * @brief apply a patch made by checkpoint::update to a copy of the encoding it was made from
+     * @param data the encoding, brought up to date
+     * @param patch
+     * @return the number of members that changed
+     */
+    inline size_t apply_patch(std::string &data, const std::string &patch) {
+        unsigned int changed = 0, index = 0;
+        uint64_t begin = 0, old = 0, len = 0;
+        size_t at = sizeof(changed);
+        auto take = [&](void *value, size_t n) {
+            if (patch.size() - at < n) {
+                std::cerr << "Invalid patch" << std::endl;
+                throw std::runtime_error("Invalid patch");
+            }
+            memcpy(value, patch.data() + at, n);
+            at += n;
+        };
+        if (patch.size() < sizeof(changed)) {
+            std::cerr << "Invalid patch" << std::endl;
+            throw std::runtime_error("Invalid patch");
+        }
+        memcpy(&changed, patch.data(), sizeof(changed));
+        for (unsigned int i = 0; i < changed; ++ i) {
+            take(&index, sizeof(index));
+            take(&begin, sizeof(begin));
+            take(&old, sizeof(old));
+            take(&len, sizeof(len));
+            if (begin > data.size() || old > data.size() - begin || len > patch.size() - at) {
+                std::cerr << "Patch of member " << index << " does not fit" << std::endl;
+                throw std::runtime_error("Invalid patch");
+            }
+            data.replace(begin, old, patch, at, len);
+            at += len;
+        }
+        return changed;
+    }
+
+    /**
+     * @brief binary serialization output entry function, compressed in blocks
+     * @param obj
+     * @param file_name
+     * @param opt the block size and codec, recorded in the file
+     * @return the output size of binary data, before compression
+     */
+    template<class T>
+    unsigned int serialize_compressed(const T& obj, const char *file_name, const block_stream::options &opt = block_stream::options()) {
+        std::ofstream file(file_name, std::ios::binary | std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        block_stream::writer_buf blocks(file, opt);
+        std::ostream out(&blocks);
+        unsigned int size = write_bin(obj, out);
+        if (!blocks.finish()) {
+            std::cerr << "Error writing file: " << file_name << std::endl;
+            throw std::runtime_error("Error writing file");
+        }
+        return size;
+    }
+
+    /**
+     * @brief binary deserialization input entry function for files written by serialize_compressed
+     * @param obj
+     * @param file_name
+     * @return the input size of binary data, after decompression
+     */
+    template<class T>
+    unsigned int deserialize_compressed(T &obj, const char *file_name) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        block_stream::reader_buf blocks(file);
+        std::istream in(&blocks);
+        unsigned int size = read_bin(obj, in);
+        if (!in || blocks.failed()) {
+            std::cerr << "Error reading compressed data of " << file_name << std::endl;
+            throw std::runtime_error("Error reading compressed data");
+        }
+        return size;
+    }
+
+    /**
+     * @brief write a container element by element, without having it in memory
+     * The count is written as 0 first and patched by end(), so the file is
+     * the same as the one serialize writes for a container of the pushed
+     * elements. Pointers keep their identity across the elements.
+     */
+    template<class T>
+    class sequence_writer {
+    public:
+        explicit sequence_writer(const char *file_name) : name(file_name) {
+            file.open(file_name, std::ios::binary | std::ios::out);
+            if (!file.is_open()) {
+                std::cerr << "Error opening file: " << file_name << std::endl;
+                throw std::runtime_error("Error opening file");
+            }
+            size = write_bin(count, file);                                                              // patched by end()
+        }
+        sequence_writer(const sequence_writer &) = delete;
+        sequence_writer &operator=(const sequence_writer &) = delete;
+        ~sequence_writer() {
+            finish_();
+        }
+
+        /**
+         * @brief write the next element
+         * @param obj
+         * @return the output size of the element
+         */
+        unsigned int push(const T &obj) {
+            type_info::identity_scope identity(identities);
+            unsigned int n = write_bin(obj, file);
+            ++ count;
+            size += n;
+            return n;
+        }
+
+        /**
+         * @brief patch the count and close the file
+         * @return the output size of binary data
+         */
+        unsigned int end() {
+            if (!finish_()) {
+                std::cerr << "Error writing file: " << name << std::endl;
+                throw std::runtime_error("Error writing file");
+            }
+            return size;
+        }
+
+    private:
+        bool finish_() {
+            if (!file.is_open()) {
+                return true;
+            }
+            file.seekp(0);
+            write_bin(count, file);
+            file.close();
+            return !file.fail();
+        }
+
+        std::string name;
+        std::ofstream file;
+        unsigned int count = 0, size = 0;
+        type_info::identity_table identities;                                                           // one pass over all the elements
+    };
+
+    /**
+     * @brief read the elements of a serialized container one at a time
+     * The file is one written by serialize for a container of T, or a
+     * std::pair<K, V> for a map. Only the element being read is held in
+     * memory. Pointers keep their identity across the elements, as they do
+     * when the whole container is read.
+     */
+    template<class T>
+    class sequence_reader {
+    public:
+        typedef T value_type;
+        typedef type_info::sequence_iterator<sequence_reader> iterator;
+
+        explicit sequence_reader(const char *file_name) : name(file_name) {
+            file.open(file_name, std::ios::binary);
+            if (!file.is_open()) {
+                std::cerr << "Error opening file: " << file_name << std::endl;
+                throw std::runtime_error("Error opening file");
+            }
+            read_bin(left, file);
+            count = left;
+        }
+        sequence_reader(const sequence_reader &) = delete;
+        sequence_reader &operator=(const sequence_reader &) = delete;
+
+        // the number of elements in the container
+        unsigned int size() const {
+            return count;
+        }
+
+        /**
+         * @brief read the next element
+         * @param obj replaced by the element
+         * @return false after the last element
+         */
+        bool next(T &obj) {
+            if (left == 0) {
+                return false;
+            }
+            type_info::identity_scope identity(identities);
+            T element{};
+            read_bin(element, file);
+            if (!file) {
+                std::cerr << "Error reading element of " << name << std::endl;
+                throw std::runtime_error("Error reading element");
+            }
+            obj = std::move(element);
+            -- left;
+            return true;
+        }
+
+        // the elements not read yet, the reader is shared by its iterators
+        iterator begin() {
+            return iterator(this);
+        }
+        iterator end() {
+            return iterator();
+        }
+
+    private:
+        std::string name;
+        std::ifstream file;
+        unsigned int count = 0, left = 0;
+        type_info::identity_table identities;                                                           // one pass over all the elements
+    };
+
+    /**
+     * @brief options of the chunked container layout
+     * @param chunk_size the number of elements encoded together in one chunk
+     * @param threads the number of threads, 0 means one per hardware thread
+     */
+    struct chunk_options {
+        unsigned int chunk_size = 1 << 16;
+        unsigned int threads = 0;
+    };
+
+    /**
+     * @brief chunked binary serialization output of a container
+     * The elements are split into chunks of opt.chunk_size which are encoded
+     * concurrently into their own buffers and written in order. The layout is
+     *     element count, chunk size, chunk count (unsigned int each)
+     *     chunk offsets (chunk count + 1 uint64_t, relative to the first chunk)
+     *     the elements, encoded as write_bin does
+     * The offset table lets a reader find each chunk without decoding the
+     * ones before it. The stream must be seekable, the table is written last.
+     * The workers write in the modes of the calling thread. Every chunk is
+     * one write pass: pointer identities and the string dictionary are shared
+     * by the elements of a chunk and start over at the next one. The element
+     * types must be registered before the call.
+     * @param obj
+     * @param file
+     * @param opt
+     * @return the output size of binary data
+     */
+    template<class T>
+    unsigned int write_bin_chunked(const T& obj, std::ostream& file, const chunk_options& opt = chunk_options()) {
+        static_assert(my_type_traits::is_container<RR(T)>::value && !my_type_traits::is_container_adaptor<RR(T)>::value,
+                      "only iterable containers can be chunked");
+        type_info::freeze();                                                                        // lock-free type lookup on the workers
+        unsigned int cnt = obj.size(), chunk = std::max(opt.chunk_size, 1u);
+        unsigned int chunks = (cnt + chunk - 1) / chunk;
+        unsigned int size = 0;
+        size += write_bin(cnt, file);
+        size += write_bin(chunk, file);
+        size += write_bin(chunks, file);
+        std::vector<uint64_t> offsets(chunks + 1, 0);
+        std::streampos table = file.tellp();
+        file.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));  // patched below
+        size += offsets.size() * sizeof(uint64_t);
+
+        std::vector<typename T::const_iterator> begins;                                             // the first element of each chunk
+        begins.reserve(chunks);
+        auto it = obj.begin();
+        for (unsigned int i = 0; i < chunks; ++ i) {
+            begins.push_back(it);
+            std::advance(it, std::min(chunk, cnt - i * chunk));
+        }
+
+        // encode a window of chunks at a time, so only a few buffers are alive at once
+        unsigned int threads = parallel::thread_count(opt.threads);
+        unsigned int window = threads * 4;
+        std::vector<std::string> buffers(window);
+        const type_info::thread_modes modes = type_info::current_modes();
+        for (unsigned int base = 0; base < chunks; base += window) {
+            unsigned int n = std::min(window, chunks - base);
+            parallel::parallel_for(n, threads, [&](size_t k) {
+                type_info::modes_scope scope(modes);
+                unsigned int first = (base + k) * chunk, last = std::min(first + chunk, cnt);
+                size_t bytes = 0;
+                auto elem = begins[base + k];
+                {
+                    type_info::identity_table sizing;                                               // the same as the write below
+                    type_info::identity_scope identity(sizing);
+                    for (unsigned int j = first; j < last; ++ j, ++ elem) {                         // size the buffer once
+                        bytes += serialized_size(*elem);
+                    }
+                }
+                buffers[k].resize(bytes);
+                block_buf out_buf(&buffers[k][0], bytes);
+                std::ostream out(&out_buf);
+                elem = begins[base + k];
+                type_info::identity_table chunk_ids;                                                // pointers and strings are shared within the chunk
+                type_info::identity_scope identity(chunk_ids);
+                for (unsigned int j = first; j < last; ++ j, ++ elem) {
+                    write_bin(*elem, out);
+                }
+                if (!out || out_buf.written() != bytes) {
+                    std::cerr << "Serialized size mismatch" << std::endl;
+                    throw std::runtime_error("Serialized size mismatch");
+                }
+            });
+            for (unsigned int k = 0; k < n; ++ k) {
+                offsets[base + k + 1] = offsets[base + k] + buffers[k].size();
+                file.write(buffers[k].data(), buffers[k].size());
+                size += buffers[k].size();
+                buffers[k].clear();
+            }
+        }
+
+        std::streampos end = file.tellp();
+        file.seekp(table);
+        file.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        file.seekp(end);
+        return size;
+    }
+
+    /**
+     * @brief the header and the offset table in front of the chunks of a chunked container
+     */
+    struct chunk_table {
+        unsigned int cnt = 0, chunk = 0, chunks = 0;
+        std::vector<uint64_t> offsets;                                                              // chunks + 1, relative to the first chunk
+        // the elements of chunk k are [first(k), last(k))
+        uint64_t first(size_t k) const { return (uint64_t)k * chunk; }
+        uint64_t last(size_t k) const { return std::min<uint64_t>(first(k) + chunk, cnt); }
+    };
+
+    // report a broken chunk table
+    inline void chunk_table_error_(const char *source) {
+        std::cerr << "Error reading chunk table of " << source << std::endl;
+        throw std::runtime_error("Error reading chunk table");
+    }
+
+    /**
+     * @brief read and check the header and the offset table written by write_bin_chunked
+     * There must be exactly the chunks the element count needs, and the
+     * offsets must start at 0, never decrease and stay inside the stream
+     * when its length can be told. The table is read step by step, so a
+     * broken chunk count stops at the end of the stream.
+     * @param table
+     * @param file positioned at the header, left at the first chunk
+     * @param source the name of the stream, for the error message
+     * @return the input size of binary data
+     */
+    inline unsigned int read_chunk_table(chunk_table &table, std::istream &file, const char *source) {
+        uint64_t length = bytes_left_(file);                                                        // from the header on
+        unsigned int size = 0;
+        size += read_bin(table.cnt, file);
+        size += read_bin(table.chunk, file);
+        size += read_bin(table.chunks, file);
+        if (!file || table.chunk == 0 || table.chunks != ((uint64_t)table.cnt + table.chunk - 1) / table.chunk) {  // exactly the chunks cnt needs
+            chunk_table_error_(source);
+        }
+        uint64_t header = 3 * sizeof(unsigned int) + ((uint64_t)table.chunks + 1) * sizeof(uint64_t);
+        if (header > length) {
+            chunk_table_error_(source);
+        }
+        table.offsets.clear();
+        const size_t step = 1 << 16;
+        for (size_t done = 0; done < (size_t)table.chunks + 1 && file; ) {
+            size_t n = std::min<size_t>(step, (size_t)table.chunks + 1 - done);
+            table.offsets.resize(done + n);
+            file.read(reinterpret_cast<char *>(table.offsets.data() + done), n * sizeof(uint64_t));
+            done += n;
+        }
+        size += (unsigned int)(((uint64_t)table.chunks + 1) * sizeof(uint64_t));
+        if (!file || table.offsets[0] != 0 || !std::is_sorted(table.offsets.begin(), table.offsets.end()) ||
+            table.offsets.back() > length - header) {                                               // a chunk never has a negative length
+            chunk_table_error_(source);
+        }
+        return size;
+    }
+
+    /**
+     * @brief chunked binary deserialization input of a container
+     * The chunks are read one after the other, each one has to take the
+     * bytes the offset table gives it. The elements are read one by one, as
+     * write_bin_chunked writes them, never as one packed or plain block.
+     * @param obj
+     * @param file
+     * @return the input size of binary data
+     */
+    template<class T>
+    unsigned int read_bin_chunked(T &obj, std::istream& file) {
+        chunk_table table;
+        unsigned int size = read_chunk_table(table, file, "stream");
+        for (unsigned int k = 0; k < table.chunks; ++ k) {
+            std::streampos start = file.tellg();
+            type_info::identity_table chunk_ids;                                                    // one read pass per chunk, as it was written
+            type_info::identity_scope identity(chunk_ids);
+            for (uint64_t i = table.first(k); i < table.last(k) && file; ++ i) {
+                size += read_element_(obj, file);
+            }
+            std::streampos end = file.tellg();
+            if (!file || (start != std::streampos(-1) && end != std::streampos(-1) &&
+                          (uint64_t)(end - start) != table.offsets[k + 1] - table.offsets[k])) {
+                std::cerr << "Error reading chunk " << k << " of stream" << std::endl;
+                throw std::runtime_error("Error reading chunk");
+            }
+        }
+        return size;
+    }
+
+    /**
+     * @brief chunked binary serialization output entry function
+     * @param obj
+     * @param file_name
+     * @param opt
+     * @return the output size of binary data
+     */
+    template<class T>
+    unsigned int serialize_chunked(const T& obj, const char *file_name, const chunk_options& opt = chunk_options()) {
+        std::ofstream file(file_name, std::ios::binary | std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file" << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        unsigned int size = write_bin_chunked(obj, file, opt);
+        file.close();
+        return size;
+    }
+
+    /**
+     * @brief decode one chunk of a chunked file on its own stream
+     * @param obj the first element of the chunk; cnt elements follow it
+     * @param cnt
+     * @param file_name
+     * @param pos the position of the chunk in the file
+     * @param len the length of the chunk in bytes
+     * @return the input size of binary data
+     */
+    template<class It>
+    unsigned int read_chunk(It obj, unsigned int cnt, const char *file_name, std::streamoff pos, uint64_t len) {
+        std::ifstream file(file_name, std::ios::binary);
+        file.seekg(pos);
+        type_info::identity_table chunk_ids;                                                        // one read pass per chunk, as it was written
+        type_info::identity_scope identity(chunk_ids);
+        unsigned int size = 0;
+        for (unsigned int i = 0; i < cnt; ++ i, ++ obj) {
+            size += read_bin(*obj, file);
+        }
+        if (!file || (uint64_t)(file.tellg() - pos) != len) {
+            std::cerr << "Error reading chunk at " << pos << " of " << file_name << std::endl;
+            throw std::runtime_error("Error reading chunk");
+        }
+        return size;
+    }
+
+    /**
+     * @brief chunked binary deserialization input entry function
+     * The chunks are decoded concurrently, each from its own stream positioned
+     * with the offset table. Vectors and deques are resized first and every
+     * chunk is decoded straight into its own range of elements; other
+     * containers get the chunks decoded into temporary elements, built with
+     * the allocator of obj, which are then inserted in order. The workers read
+     * in the modes of the calling thread. The element types must be
+     * registered before the call.
+     * @param obj
+     * @param file_name
+     * @param opt only opt.threads is used
+     * @return the input size of binary data
+     */
+    template<class T>
+    unsigned int deserialize_chunked(T &obj, const char *file_name, const chunk_options& opt = chunk_options()) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening file");
+        }
+        chunk_table table;
+        unsigned int size = read_chunk_table(table, file, file_name);
+        const unsigned int cnt = table.cnt, chunks = table.chunks;
+        const std::vector<uint64_t> &offsets = table.offsets;
+        std::streamoff data = file.tellg();
+        file.close();
+
+        type_info::freeze();                                                                        // lock-free type lookup on the workers
+        const type_info::thread_modes modes = type_info::current_modes();
+        typedef typename std::remove_cv<typename T::value_type>::type value_type;
+        std::vector<unsigned int> sizes(chunks, 0);
+        if constexpr (my_type_traits::is_random_access_container<RR(T)>::value &&
+                      !std::is_same<value_type, bool>::value) {                                         // decode in place
+            size_t old = obj.size();
+            obj.resize(old + cnt);
+            parallel::parallel_for(chunks, opt.threads, [&](size_t k) {
+                type_info::modes_scope scope(modes);
+                uint64_t first = table.first(k), last = table.last(k);
+                sizes[k] = read_chunk(obj.begin() + old + first, last - first, file_name,
+                                      data + offsets[k], offsets[k + 1] - offsets[k]);
+            });
+        } else {                                                                                        // decode aside, insert in order
+            typedef my_type_traits::mutable_value_t<typename T::value_type> element_type;
+            std::vector<std::deque<element_type>> parts(chunks);
+            parallel::parallel_for(chunks, opt.threads, [&](size_t k) {
+                type_info::modes_scope scope(modes);
+                uint64_t first = table.first(k), last = table.last(k);
+                for (uint64_t i = first; i < last; ++ i) {                                              // with the allocator of obj
+                    parts[k].push_back(type_info::make_element<element_type>(type_info::allocator_of(obj)));
+                }
+                sizes[k] = read_chunk(parts[k].begin(), last - first, file_name,
+                                      data + offsets[k], offsets[k + 1] - offsets[k]);
+            });
+            for (unsigned int k = 0; k < chunks; ++ k) {
+                uint64_t first = table.first(k), last = table.last(k);
+                for (uint64_t i = 0; i < last - first; ++ i) {
+                    if constexpr (my_type_traits::is_sequence_container<RR(T)>::value) {
+                        obj.push_back(std::move(parts[k][i]));
+                    } else {
+                        obj.insert(std::move(parts[k][i]));
+                    }
+                }
+                parts[k].clear();
+            }
+        }
+        for (unsigned int k = 0; k < chunks; ++ k) {
+            size += sizes[k];
+        }
+        return size;
+    }
+
+    /**
+     * @brief chunked binary deserialization input entry function, reading into a memory resource
+     * See deserialize with a resource. The workers allocate from resource at
+     * the same time, so it has to be thread safe, like
+     * std::pmr::synchronized_pool_resource, unless opt.threads is 1.
+     * @param obj
+     * @param file_name
+     * @param resource
+     * @param opt only opt.threads is used
+     * @return the input size of binary data
+     */
+    template<class T>
+    unsigned int deserialize_chunked(T &obj, const char *file_name, std::pmr::memory_resource *resource,
+                                     const chunk_options& opt = chunk_options()) {
+        type_info::resource_scope scope(resource);
+        return deserialize_chunked(obj, file_name, opt);
+    }
+
+    /**
+     * @brief the frame in front of every record of a record log
+     * @param length the size of the payload that follows, as write_bin writes it
+     * @param type the type id of the record, see type_info::dispatch<T>::id()
+     */
+    struct record_header {
+        uint64_t length;
+        uint64_t type;
+    };
+
+    // the side index of a record log keeps one uint64_t offset per record
+    inline std::string record_index_name(const char *file_name) {
+        return std::string(file_name) + ".idx";
+    }
+
+    /**
+     * @brief an append-only log of binary records
+     * The log is opened once and any number of objects are appended to it,
+     * each framed by a record_header. The payload is sized beforehand, so it
+     * is written straight to the file. The offset of every record is appended
+     * to the side index as well, which lets a reader seek to record k without
+     * walking the frames before it.
+     */
+    class record_writer {
+    public:
+        /**
+         * @brief open a record log for appending, it is created if it does not exist
+         * @param file_name
+         * @param index keep the side index up to date
+         */
+        explicit record_writer(const char *file_name, bool index = true) {
+            file.open(file_name, std::ios::binary | std::ios::app);
+            if (!file.is_open()) {
+                std::cerr << "Error opening file: " << file_name << std::endl;
+                throw std::runtime_error("Error opening file");
+            }
+            file.seekp(0, std::ios::end);
+            offset = file.tellp();
+            if (index) {
+                std::string index_name = record_index_name(file_name);
+                index_file.open(index_name, std::ios::binary | std::ios::app);
+                if (!index_file.is_open()) {
+                    std::cerr << "Error opening file: " << index_name << std::endl;
+                    throw std::runtime_error("Error opening file");
+                }
+            }
+        }
+
+        /**
+         * @brief append one record
+         * @param obj
+         * @return the offset of the record in the log
+         */
+        template<class T>
+        uint64_t append(const T &obj) {
+            record_header header = {serialized_size(obj), type_info::dispatch<RR(T)>::id()};
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            write_bin(obj, file);
+            if (!file) {
+                std::cerr << "Error writing record" << std::endl;
+                throw std::runtime_error("Error writing record");
+            }
+            uint64_t at = offset;
+            if (index_file.is_open()) {
+                index_file.write(reinterpret_cast<const char *>(&at), sizeof(at));
+            }
+            offset += sizeof(header) + header.length;
+            return at;
+        }
+
+        // push the appended records to the file
+        void flush() {
+            file.flush();
+            if (index_file.is_open()) {
+                index_file.flush();
+            }
+        }
+
+    private:
+        std::ofstream file, index_file;
+        uint64_t offset = 0;                                                                            // the end of the log
+    };
+
+    /**
+     * @brief the reader of a record log
+     * Records are visited one by one with next(), which reads only the frame,
+     * so records of other types are skipped without decoding them. read(k)
+     * seeks to record k, using the side index for the records it covers and
+     * walking the frames once for the rest. A torn record at the end of the
+     * log, left by a writer that stopped half way, is not counted.
+     */
+    class record_reader {
+    public:
+        explicit record_reader(const char *file_name) : name(file_name) {
+            file.open(file_name, std::ios::binary);
+            if (!file.is_open()) {
+                std::cerr << "Error opening file: " << file_name << std::endl;
+                throw std::runtime_error("Error opening file");
+            }
+            file.seekg(0, std::ios::end);
+            size = file.tellg();
+            file.seekg(0);
+        }
+
+        // the number of records in the log
+        uint64_t count() {
+            load_offsets_();
+            return offsets.size();
+        }
+
+        /**
+         * @brief move to the next record, the first one after rewind()
+         * @return false at the end of the log
+         */
+        bool next() {
+            return at_(started ? current + sizeof(record_header) + header.length : 0);
+        }
+
+        // start over from the first record
+        void rewind() {
+            started = false;
+        }
+
+        // the type id of the current record
+        uint64_t type() const {
+            return header.type;
+        }
+
+        // if the current record holds a T
+        template<class T>
+        bool holds() const {
+            return header.type == type_info::dispatch<RR(T)>::id();
+        }
+
+        /**
+         * @brief decode the current record
+         * @param obj
+         * @return the size of the payload
+         */
+        template<class T>
+        uint64_t get(T &obj) {
+            if (!started || !holds<T>()) {
+                std::cerr << "Record type mismatch in " << name << std::endl;
+                throw std::runtime_error("Record type mismatch");
+            }
+            file.clear();
+            file.seekg(current + sizeof(record_header));
+            uint64_t length = read_bin(obj, file);
+            if (!file || length != header.length) {
+                std::cerr << "Error reading record of " << name << std::endl;
+                throw std::runtime_error("Error reading record");
+            }
+            return length;
+        }
+
+        /**
+         * @brief decode record k, next() goes on with record k + 1
+         * @param k
+         * @param obj
+         * @return the size of the payload
+         */
+        template<class T>
+        uint64_t read(uint64_t k, T &obj) {
+            load_offsets_();
+            if (k >= offsets.size() || !at_(offsets[k])) {
+                std::cerr << "Record " << k << " out of range in " << name << std::endl;
+                throw std::runtime_error("Record out of range");
+            }
+            return get(obj);
+        }
+
+    private:
+        // read the frame at offset, false if there is no whole record there
+        bool at_(uint64_t offset) {
+            record_header frame;
+            if (!frame_(offset, frame)) {
+                return false;
+            }
+            header = frame;
+            current = offset;
+            started = true;
+            return true;
+        }
+
+        bool frame_(uint64_t offset, record_header &frame) {
+            if (offset + sizeof(record_header) > size) {
+                return false;
+            }
+            file.clear();
+            file.seekg(offset);
+            file.read(reinterpret_cast<char *>(&frame), sizeof(frame));
+            return file && frame.length <= size - offset - sizeof(record_header);
+        }
+
+        // take the offsets from the side index as far as they agree with the log, walk the frames after them
+        void load_offsets_() {
+            if (loaded) {
+                return;
+            }
+            std::ifstream index_file(record_index_name(name.c_str()), std::ios::binary);
+            uint64_t offset = 0, end = 0;
+            record_header frame;
+            while (index_file.read(reinterpret_cast<char *>(&offset), sizeof(offset))) {
+                if (offset != end || !frame_(offset, frame)) {
+                    break;
+                }
+                offsets.push_back(offset);
+                end = offset + sizeof(record_header) + frame.length;
+            }
+            while (frame_(end, frame)) {
+                offsets.push_back(end);
+                end += sizeof(record_header) + frame.length;
+            }
+            loaded = true;
+        }
+
+        std::string name;
+        std::ifstream file;
+        uint64_t size = 0;
+        std::vector<uint64_t> offsets;                                                                  // the offset of every record
+        bool loaded = false;
+        record_header header = {0, 0};                                                                  // the frame of the current record
+        uint64_t current = 0;
+        bool started = false;
+    };
 }
\ No newline at end of file
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define BLOCK_STREAM_SSE42
+#endif
+
+/**
+ * @brief The block_stream namespace
+ * This namespace contains a framed block format the serializers can put in
+ * front of a file: the data is cut into blocks which are compressed one by
+ * one, with a small dependency-free LZ77 codec, and checked with CRC32C.
+ * It is read back through a stream buffer, so write_bin, read_bin and the
+ * xml printer work on it as on any other stream.
+ *
+ * The file starts with a file_header, then every block is a block_header
+ * followed by its stored bytes.
+ */
+namespace block_stream {
+
+    // how the blocks are stored
+    enum codec : uint32_t {
+        codec_none = 0,                                             // as they are
+        codec_lz = 1                                                // compressed with lz_compress
+    };
+
+    // the flags of a framed file
+    enum flag : uint32_t {
+        flag_checksum = 1                                           // the blocks carry the crc32c of their stored bytes
+    };
+
+    /**
+     * @brief options of the block format
+     * @param block_size the number of bytes compressed together
+     * @param codec how the blocks are stored
+     * @param checksum write a crc32c for every block, which the reader checks
+     */
+    struct options {
+        unsigned int block_size = 1 << 16;
+        block_stream::codec codec = codec_lz;
+        bool checksum = true;
+    };
+
+    /**
+     * @brief the header of a framed file
+     * @param magic "TXBS"
+     * @param codec how the blocks are stored
+     * @param block_size the largest number of bytes in a block
+     * @param flags see flag
+     */
+    struct file_header {
+        char magic[4];
+        uint32_t codec;
+        uint32_t block_size;
+        uint32_t flags;
+    };
+
+    /**
+     * @brief the header of a block
+     * @param size the number of bytes in the block
+     * @param stored the number of bytes stored, equal to size if the block did not compress
+     * @param crc the crc32c of the stored bytes, 0 without flag_checksum
+     */
+    struct block_header {
+        uint32_t size;
+        uint32_t stored;
+        uint32_t crc;
+    };
+
+    inline const char file_magic[4] = {'T', 'X', 'B', 'S'};
+
+    // the crc32c lookup tables, the k-th one gives the crc of a byte followed by k zero bytes
+    struct crc32c_tables {
+        uint32_t table[8][256];
+        crc32c_tables() {
+            for (uint32_t n = 0; n < 256; ++ n) {
+                uint32_t crc = n;
+                for (int k = 0; k < 8; ++ k) {
+                    crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78u : crc >> 1;
+                }
+                table[0][n] = crc;
+            }
+            for (uint32_t n = 0; n < 256; ++ n) {
+                for (int k = 1; k < 8; ++ k) {
+                    table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xff];
+                }
+            }
+        }
+    };
+
+    // crc32c without the final inversion, eight bytes a step through the tables
+    inline uint32_t crc32c_table_(uint32_t crc, const char *data, size_t n) {
+        static const crc32c_tables tables;
+        const uint32_t (&t)[8][256] = tables.table;
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+        for (; n >= 8; n -= 8, p += 8) {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            v ^= crc;
+            crc = t[7][v & 0xff] ^ t[6][(v >> 8) & 0xff] ^ t[5][(v >> 16) & 0xff] ^ t[4][(v >> 24) & 0xff] ^
+                  t[3][(v >> 32) & 0xff] ^ t[2][(v >> 40) & 0xff] ^ t[1][(v >> 48) & 0xff] ^ t[0][v >> 56];
+        }
+        for (; n > 0; -- n, ++ p) {
+            crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+        }
+        return crc;
+    }
+
+#ifdef BLOCK_STREAM_SSE42
+    // crc32c without the final inversion, with the SSE4.2 crc32 instruction
+    __attribute__((target("sse4.2")))
+    inline uint32_t crc32c_sse42_(uint32_t crc, const char *data, size_t n) {
+        uint64_t crc64 = crc;
+        for (; n >= 8; n -= 8, data += 8) {
+            uint64_t v;
+            memcpy(&v, data, sizeof(v));
+            crc64 = _mm_crc32_u64(crc64, v);
+        }
+        crc = (uint32_t)crc64;
+        for (; n > 0; -- n, ++ data) {
+            crc = _mm_crc32_u8(crc, (unsigned char)*data);
+        }
+        return crc;
+    }
+#endif
+
+    /**
+     * @brief the crc32c (Castagnoli) of a block of bytes
+     * The SSE4.2 instruction is used when the processor has it, checked once
+     * at run time, and the lookup tables otherwise.
+     * @param data
+     * @param n
+     * @param crc the crc of the bytes in front of data, to go on from
+     * @return the crc
+     */
+    inline uint32_t crc32c(const char *data, size_t n, uint32_t crc = 0) {
+#ifdef BLOCK_STREAM_SSE42
+        static const bool hardware = __builtin_cpu_supports("sse4.2");
+        if (hardware) return ~crc32c_sse42_(~crc, data, n);
+#endif
+        return ~crc32c_table_(~crc, data, n);
+    }
+
+    // the most bytes lz_compress writes for n bytes
+    inline size_t lz_bound(size_t n) {
+        return n + n / 255 + 16;
+    }
+
+    /**
+     * @brief compress a block
+     * The output is a run of sequences, each a token byte holding the number
+     * of literals and the match length - 4 in four bits each (15 means more
+     * length bytes follow, 255 meaning more again), the literals, and the
+     * offset of the match as two bytes. The last sequence has literals only.
+     * @param src
+     * @param n
+     * @param dst at least lz_bound(n) bytes
+     * @return the compressed size
+     */
+    inline size_t lz_compress(const char *src, size_t n, char *dst) {
+        const int hash_bits = 14;
+        const size_t min_match = 4, tail = 12;                                                          // the last bytes are never matched
+        std::vector<uint32_t> table(1 << hash_bits, 0);                                                 // position + 1 of the last sight of a hash
+        const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+        unsigned char *out = reinterpret_cast<unsigned char *>(dst);
+        size_t o = 0, anchor = 0, i = 0;
+        auto load = [&](size_t at) {
+            uint32_t v;
+            memcpy(&v, in + at, sizeof(v));
+            return v;
+        };
+        auto length = [&](size_t len) {                                                                 // the length bytes past the token
+            for (; len >= 255; len -= 255) out[o ++] = 255;
+            out[o ++] = (unsigned char)len;
+        };
+        auto literals = [&](size_t match) {                                                             // the token and literals up to i
+            size_t lit = i - anchor;
+            out[o ++] = (unsigned char)((std::min<size_t>(lit, 15) << 4) | std::min<size_t>(match, 15));
+            if (lit >= 15) length(lit - 15);
+            memcpy(out + o, in + anchor, lit);
+            o += lit;
+        };
+        while (n >= tail && i + tail <= n) {
+            uint32_t seq = load(i);
+            uint32_t h = (seq * 2654435761u) >> (32 - hash_bits);
+            size_t candidate = table[h];
+            table[h] = (uint32_t)(i + 1);
+            if (candidate == 0 || i + 1 - candidate > 65535 || load(candidate - 1) != seq) {
+                i += 1 + ((i - anchor) >> 6);                                                           // skip faster over data that does not match
+                continue;
+            }
+            size_t from = candidate - 1, len = min_match;
+            while (i + len + 5 < n && in[from + len] == in[i + len]) ++ len;
+            literals(len - min_match);
+            out[o ++] = (unsigned char)(i - from);
+            out[o ++] = (unsigned char)((i - from) >> 8);
+            if (len - min_match >= 15) length(len - min_match - 15);
+            i += len;
+            anchor = i;
+        }
+        i = n;
+        literals(0);
+        return o;
+    }
+
+    /**
+     * @brief decompress a block written by lz_compress
+     * @param src
+     * @param n
+     * @param dst
+     * @param size the size of the block
+     * @return false if src is not a block of size bytes
+     */
+    inline bool lz_decompress(const char *src, size_t n, char *dst, size_t size) {
+        const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+        size_t i = 0, o = 0;
+        auto length = [&](size_t &len) {
+            for (unsigned char b = 255; b == 255; len += b) {
+                if (i >= n) return false;
+                b = in[i ++];
+            }
+            return true;
+        };
+        for (;;) {
+            if (i >= n) return false;
+            unsigned char token = in[i ++];
+            size_t lit = token >> 4, len = token & 15;
+            if (lit == 15 && !length(lit)) return false;
+            if (lit > n - i || lit > size - o) return false;
+            memcpy(dst + o, in + i, lit);
+            i += lit;
+            o += lit;
+            if (i == n) return o == size;
+            if (n - i < 2) return false;
+            size_t offset = in[i] | (in[i + 1] << 8);
+            i += 2;
+            if (len == 15 && !length(len)) return false;
+            len += 4;
+            if (offset == 0 || offset > o || len > size - o) return false;
+            if (offset >= len) {
+                memcpy(dst + o, dst + o - offset, len);
+                o += len;
+            } else {
+                for (size_t k = 0; k < len; ++ k, ++ o) {                                             // the match overlaps itself
+                    dst[o] = dst[o - offset];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief a stream buffer writing the framed block format to a stream
+     * Call finish() after the last write, which stores the last block.
+     */
+    class writer_buf : public std::streambuf {
+    public:
+        writer_buf(std::ostream &sink, const options &opt = options()) : sink(sink), opt(opt), block(opt.block_size) {
+            if (opt.block_size == 0) {
+                std::cerr << "Invalid block size" << std::endl;
+                throw std::runtime_error("Invalid block size");
+            }
+            file_header header;
+            memcpy(header.magic, file_magic, sizeof(header.magic));
+            header.codec = opt.codec;
+            header.block_size = opt.block_size;
+            header.flags = opt.checksum ? (uint32_t)flag_checksum : 0u;
+            sink.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            setp(block.data(), block.data() + block.size());
+        }
+        writer_buf(const writer_buf &) = delete;
+        writer_buf &operator=(const writer_buf &) = delete;
+
+        // store the last block, false if the sink failed
+        bool finish() {
+            store_();
+            return !sink.fail();
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (!store_()) return traits_type::eof();
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+    private:
+        bool store_() {
+            block_header header = {(uint32_t)(pptr() - pbase()), 0, 0};
+            if (header.size == 0) return !sink.fail();
+            const char *data = pbase();
+            header.stored = header.size;
+            if (opt.codec == codec_lz) {
+                packed.resize(lz_bound(header.size));
+                size_t stored = lz_compress(pbase(), header.size, packed.data());
+                if (stored < header.size) {
+                    header.stored = (uint32_t)stored;
+                    data = packed.data();
+                }
+            }
+            if (opt.checksum) {
+                header.crc = crc32c(data, header.stored);
+            }
+            sink.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            sink.write(data, header.stored);
+            setp(block.data(), block.data() + block.size());
+            return !sink.fail();
+        }
+
+        std::ostream &sink;
+        options opt;
+        std::vector<char> block, packed;
+    };
+
+    /**
+     * @brief a stream buffer reading the framed block format from a stream
+     * A block that is cut short, fails its checksum or does not decompress
+     * ends the data and sets failed(), so the reads past it fail the stream
+     * that reads.
+     */
+    class reader_buf : public std::streambuf {
+    public:
+        explicit reader_buf(std::istream &source) : source(source) {
+            file_header header;
+            source.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (!source || memcmp(header.magic, file_magic, sizeof(header.magic)) != 0 ||
+                header.codec > codec_lz || header.block_size == 0 || (header.flags & ~flag_checksum) != 0) {
+                std::cerr << "Not a block stream" << std::endl;
+                throw std::runtime_error("Not a block stream");
+            }
+            block_size = header.block_size;
+            checksum = (header.flags & flag_checksum) != 0;
+            block.resize(block_size);
+            setg(block.data(), block.data(), block.data());
+        }
+        reader_buf(const reader_buf &) = delete;
+        reader_buf &operator=(const reader_buf &) = delete;
+
+        // if a damaged block was met
+        bool failed() const {
+            return error;
+        }
+
+    protected:
+        int_type underflow() override {
+            if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+            if (error || !load_()) return traits_type::eof();
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        bool load_() {
+            block_header header;
+            source.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (source.gcount() == 0) return false;                                                     // the end of the data
+            error = true;
+            if (!source || header.size == 0 || header.size > block_size || header.stored > header.size) return false;
+            char *data = block.data();
+            if (header.stored < header.size) {
+                packed.resize(header.stored);
+                data = packed.data();
+            }
+            source.read(data, header.stored);
+            if (!source) return false;
+            if (checksum && crc32c(data, header.stored) != header.crc) {
+                std::cerr << "Block checksum mismatch" << std::endl;
+                return false;
+            }
+            if (header.stored < header.size && !lz_decompress(packed.data(), header.stored, block.data(), header.size)) return false;
+            error = false;
+            setg(block.data(), block.data(), block.data() + header.size);
+            return true;
+        }
+
+        std::istream &source;
+        uint32_t block_size = 0;
+        bool checksum = false;
+        std::vector<char> block, packed;
+        bool error = false;
+    };
+}
\ No newline at end of file
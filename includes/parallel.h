@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The parallel namespace
+ * This namespace contains the small threading helpers the serializers use
+ * to spread independent pieces of work over several cores.
+ */
+namespace parallel {
+
+    /**
+     * @brief the number of worker threads to use
+     * @param threads the requested number, 0 means one per hardware thread
+     * @return at least 1
+     */
+    inline unsigned int thread_count(unsigned int threads) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        return threads == 0 ? 1 : threads;
+    }
+
+    /**
+     * @brief call f(i) for every i in [0, n) on up to `threads` threads
+     * The calling thread takes part in the work. The indices are handed out one
+     * by one, so uneven pieces of work still balance. The first exception
+     * thrown by f is rethrown after all the threads have finished.
+     * @param n the number of indices
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @param f the function to call
+     */
+    template<class F>
+    void parallel_for(size_t n, unsigned int threads, F f) {
+        threads = thread_count(threads);
+        if (threads > n) {
+            threads = (unsigned int)n;
+        }
+        if (threads <= 1) {
+            for (size_t i = 0; i < n; ++ i) {
+                f(i);
+            }
+            return;
+        }
+        std::atomic<size_t> next(0);
+        std::exception_ptr error;
+        std::mutex error_lock;
+        auto work = [&]() {
+            for (size_t i = next++; i < n; i = next++) {
+                try {
+                    f(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if (!error) error = std::current_exception();
+                    next = n;                                                       // stop handing out work
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned int t = 1; t < threads; ++ t) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * @brief call f(worker, i) for every i in [0, n) on a work stealing pool
+     * Every worker starts with its own contiguous share of the indices and
+     * takes them from the front. A worker that runs out steals the back half
+     * of the largest share left. worker is in [0, threads) and stays the same
+     * for all the calls made on one thread, so f can keep per-thread state
+     * indexed by it. The first exception thrown by f is rethrown after all the
+     * threads have finished.
+     * @param n the number of indices
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @param f the function to call
+     */
+    template<class F>
+    void work_stealing_for(size_t n, unsigned int threads, F f) {
+        threads = thread_count(threads);
+        if (threads > n) {
+            threads = (unsigned int)n;
+        }
+        if (threads <= 1) {
+            for (size_t i = 0; i < n; ++ i) {
+                f(0u, i);
+            }
+            return;
+        }
+        struct share {
+            std::mutex lock;
+            size_t begin, end;
+        };
+        std::unique_ptr<share[]> shares(new share[threads]);
+        for (unsigned int t = 0; t < threads; ++ t) {
+            shares[t].begin = n * t / threads;
+            shares[t].end = n * (t + 1) / threads;
+        }
+        auto steal = [&](unsigned int self) {
+            for (;;) {
+                unsigned int victim = self;
+                size_t most = 0;
+                for (unsigned int t = 0; t < threads; ++ t) {                                   // pick the largest share
+                    std::lock_guard<std::mutex> guard(shares[t].lock);
+                    if (t != self && shares[t].end - shares[t].begin > most) {
+                        most = shares[t].end - shares[t].begin;
+                        victim = t;
+                    }
+                }
+                if (victim == self) return false;
+                size_t begin, end;
+                {
+                    std::lock_guard<std::mutex> guard(shares[victim].lock);
+                    size_t left = shares[victim].end - shares[victim].begin;
+                    if (left == 0) continue;                                                    // someone else got there first
+                    end = shares[victim].end;
+                    begin = end - (left + 1) / 2;
+                    shares[victim].end = begin;
+                }
+                std::lock_guard<std::mutex> guard(shares[self].lock);
+                shares[self].begin = begin;
+                shares[self].end = end;
+                return true;
+            }
+        };
+        std::atomic<bool> stop(false);
+        std::exception_ptr error;
+        std::mutex error_lock;
+        auto work = [&](unsigned int self) {
+            while (!stop) {
+                size_t i;
+                {
+                    std::lock_guard<std::mutex> guard(shares[self].lock);
+                    i = shares[self].begin < shares[self].end ? shares[self].begin++ : n;
+                }
+                if (i == n) {
+                    if (!steal(self)) return;
+                    continue;
+                }
+                try {
+                    f(self, i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if (!error) error = std::current_exception();
+                    stop = true;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned int t = 1; t < threads; ++ t) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
\ No newline at end of file
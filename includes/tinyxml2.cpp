@@ -100,6 +100,19 @@ distribution.
 	#define TIXML_SSCANF   sscanf
 #endif
 
+// std::to_chars / std::from_chars (C++17, with floating point support) are
+// locale independent and parse no format strings, so the number conversions
+// in XMLUtil use them in place of snprintf / sscanf when they are available.
+#if defined(__has_include) && !defined(TIXML_NO_CHARCONV)
+	#if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+		#include <charconv>
+		#include <type_traits>
+	#endif
+#endif
+#if defined(__cpp_lib_to_chars)
+	#define TIXML_USE_CHARCONV
+#endif
+
 #if defined(_WIN64)
 	#define TIXML_FSEEK _fseeki64
 	#define TIXML_FTELL _ftelli64
@@ -571,23 +584,183 @@ const char* XMLUtil::GetCharacterRef( const char* p, char* value, int* length )
 }
 
 
+void XMLUtil::ToStr( bool v, char* buffer, int bufferSize )
+{
+    TIXMLASSERT( bufferSize > 0 );
+    const char* str = v ? writeBoolTrue : writeBoolFalse;
+    int i = 0;
+    for( ; i < bufferSize - 1 && str[i]; ++i ) {
+        buffer[i] = str[i];
+    }
+    buffer[i] = 0;
+}
+
+
+bool XMLUtil::ToBool( const char* str, bool* value )
+{
+    int ival = 0;
+    if ( ToInt( str, &ival )) {
+        *value = (ival==0) ? false : true;
+        return true;
+    }
+    static const char* TRUE_VALS[] = { "true", "True", "TRUE", 0 };
+    static const char* FALSE_VALS[] = { "false", "False", "FALSE", 0 };
+
+    for (int i = 0; TRUE_VALS[i]; ++i) {
+        if (StringEqual(str, TRUE_VALS[i])) {
+            *value = true;
+            return true;
+        }
+    }
+    for (int i = 0; FALSE_VALS[i]; ++i) {
+        if (StringEqual(str, FALSE_VALS[i])) {
+            *value = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+#if defined(TIXML_USE_CHARCONV)
+
+// Writes v null terminated into buffer. Floating point values get the
+// shortest representation that reads back to the same value.
+template< class T >
+static void CharconvToStr( T v, char* buffer, int bufferSize )
+{
+    TIXMLASSERT( bufferSize > 0 );
+    const std::to_chars_result result = std::to_chars( buffer, buffer + bufferSize - 1, v );
+    *( result.ec == std::errc() ? result.ptr : buffer ) = 0;
+}
+
+// Skips what sscanf would accept in front of the digits: white space, a '+'
+// sign and, for hex, the "0x" prefix. from_chars handles none of them.
+static const char* NumberStart( const char* str, bool* hex )
+{
+    const char* p = XMLUtil::SkipWhiteSpace( str, 0 );
+    *hex = XMLUtil::IsPrefixHex( p );
+    if ( *hex ) {
+        return p + 2;
+    }
+    return ( *p == '+' ) ? p + 1 : p;
+}
+
+template< class T >
+static bool CharconvToInteger( const char* str, T* value )
+{
+    bool hex = false;
+    const char* p = NumberStart( str, &hex );
+    const char* end = p + strlen( p );
+    if ( hex ) {
+        // hex is read as the unsigned bit pattern, as "%x" does
+        typename std::make_unsigned<T>::type v = 0;
+        if ( std::from_chars( p, end, v, 16 ).ec != std::errc() ) {
+            return false;
+        }
+        *value = static_cast<T>( v );
+        return true;
+    }
+    return std::from_chars( p, end, *value ).ec == std::errc();
+}
+
+template< class T >
+static bool CharconvToFloat( const char* str, T* value )
+{
+    bool hex = false;
+    const char* p = NumberStart( str, &hex );
+    if ( hex ) {
+        return false;
+    }
+    return std::from_chars( p, p + strlen( p ), *value ).ec == std::errc();
+}
+
+
 void XMLUtil::ToStr( int v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%d", v );
+    CharconvToStr( v, buffer, bufferSize );
 }
 
 
 void XMLUtil::ToStr( unsigned v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%u", v );
+    CharconvToStr( v, buffer, bufferSize );
 }
 
 
-void XMLUtil::ToStr( bool v, char* buffer, int bufferSize )
+void XMLUtil::ToStr( float v, char* buffer, int bufferSize )
+{
+    CharconvToStr( v, buffer, bufferSize );
+}
+
+
+void XMLUtil::ToStr( double v, char* buffer, int bufferSize )
+{
+    CharconvToStr( v, buffer, bufferSize );
+}
+
+
+void XMLUtil::ToStr( int64_t v, char* buffer, int bufferSize )
+{
+    CharconvToStr( v, buffer, bufferSize );
+}
+
+
+void XMLUtil::ToStr( uint64_t v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%s", v ? writeBoolTrue : writeBoolFalse);
+    CharconvToStr( v, buffer, bufferSize );
 }
 
+
+bool XMLUtil::ToInt( const char* str, int* value )
+{
+    return CharconvToInteger( str, value );
+}
+
+
+bool XMLUtil::ToUnsigned( const char* str, unsigned* value )
+{
+    return CharconvToInteger( str, value );
+}
+
+
+bool XMLUtil::ToFloat( const char* str, float* value )
+{
+    return CharconvToFloat( str, value );
+}
+
+
+bool XMLUtil::ToDouble( const char* str, double* value )
+{
+    return CharconvToFloat( str, value );
+}
+
+
+bool XMLUtil::ToInt64( const char* str, int64_t* value )
+{
+    return CharconvToInteger( str, value );
+}
+
+
+bool XMLUtil::ToUnsigned64( const char* str, uint64_t* value )
+{
+    return CharconvToInteger( str, value );
+}
+
+#else	// TIXML_USE_CHARCONV
+
+void XMLUtil::ToStr( int v, char* buffer, int bufferSize )
+{
+    TIXML_SNPRINTF( buffer, bufferSize, "%d", v );
+}
+
+
+void XMLUtil::ToStr( unsigned v, char* buffer, int bufferSize )
+{
+    TIXML_SNPRINTF( buffer, bufferSize, "%u", v );
+}
+
+
 /*
 	ToStr() of a number is a very tricky topic.
 	https://github.com/leethomason/tinyxml2/issues/106
@@ -641,32 +814,6 @@ bool XMLUtil::ToUnsigned(const char* str, unsigned* value)
     return false;
 }
 
-bool XMLUtil::ToBool( const char* str, bool* value )
-{
-    int ival = 0;
-    if ( ToInt( str, &ival )) {
-        *value = (ival==0) ? false : true;
-        return true;
-    }
-    static const char* TRUE_VALS[] = { "true", "True", "TRUE", 0 };
-    static const char* FALSE_VALS[] = { "false", "False", "FALSE", 0 };
-
-    for (int i = 0; TRUE_VALS[i]; ++i) {
-        if (StringEqual(str, TRUE_VALS[i])) {
-            *value = true;
-            return true;
-        }
-    }
-    for (int i = 0; FALSE_VALS[i]; ++i) {
-        if (StringEqual(str, FALSE_VALS[i])) {
-            *value = false;
-            return true;
-        }
-    }
-    return false;
-}
-
-
 bool XMLUtil::ToFloat( const char* str, float* value )
 {
     if ( TIXML_SSCANF( str, "%f", value ) == 1 ) {
@@ -714,6 +861,8 @@ bool XMLUtil::ToUnsigned64(const char* str, uint64_t* value) {
     return false;
 }
 
+#endif	// TIXML_USE_CHARCONV
+
 
 char* XMLDocument::Identify( char* p, XMLNode** node )
 {
@@ -2168,6 +2317,9 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespaceMode ) :
     _parseCurLineNum( 0 ),
 	_parsingDepth(0),
     _unlinked(),
+    _adopted(),
+    _arena( 0 ),
+    _arenaPool(),
     _elementPool(),
     _attributePool(),
     _textPool(),
@@ -2203,6 +2355,13 @@ void XMLDocument::Clear()
 	while( _unlinked.Size()) {
 		DeleteNode(_unlinked[0]);	// Will remove from _unlinked as part of delete.
 	}
+	// The adopted documents own the memory of the nodes deleted above.
+	while( _adopted.Size()) {
+		delete _adopted.Pop();
+	}
+	// And the block of Finalize() those of the nodes it moved.
+	delete [] _arena;
+	_arena = 0;
 
 #ifdef TINYXML2_DEBUG
     const bool hadError = Error();
@@ -2252,6 +2411,210 @@ XMLElement* XMLDocument::NewElement( const char* name )
 }
 
 
+void XMLDocument::PrepareAdoption( XMLNode* parent, int lineOffset )
+{
+    TIXMLASSERT( parent );
+    TIXMLASSERT( parent->_document != this );
+    XMLDocument* owner = parent->_document;
+    for( XMLNode* top = _firstChild; top; top = top->_next ) {
+        // Walk the subtree without recursion; it can be deep.
+        XMLNode* node = top;
+        while( node ) {
+            node->_document = owner;
+            node->_parseLineNum += lineOffset;
+            XMLElement* ele = node->ToElement();
+            if ( ele ) {
+                for( XMLAttribute* a = ele->_rootAttribute; a; a = a->_next ) {
+                    a->_parseLineNum += lineOffset;
+                }
+            }
+            if ( node->_firstChild ) {
+                node = node->_firstChild;
+                continue;
+            }
+            while( node != top && !node->_next ) {
+                node = node->_parent;
+            }
+            node = ( node == top ) ? 0 : node->_next;
+        }
+        top->_parent = parent;
+    }
+}
+
+
+void XMLDocument::AdoptChildren( XMLDocument* part )
+{
+    TIXMLASSERT( part );
+    TIXMLASSERT( part != this );
+    XMLNode* first = part->_firstChild;
+    if ( first ) {
+        XMLNode* parent = first->_parent;
+        TIXMLASSERT( parent && parent->_document == this );
+        if ( parent->_lastChild ) {
+            parent->_lastChild->_next = first;
+            first->_prev = parent->_lastChild;
+        }
+        else {
+            parent->_firstChild = first;
+        }
+        parent->_lastChild = part->_lastChild;
+        part->_firstChild = part->_lastChild = 0;
+    }
+    _adopted.Push( part );
+}
+
+
+// Size of a node in the block of Finalize(), rounded so the next one is aligned.
+static size_t ArenaItemSize( size_t size )
+{
+    return ( size + sizeof( void* ) - 1 ) / sizeof( void* ) * sizeof( void* );
+}
+
+
+static size_t ArenaNodeSize( const XMLNode* node )
+{
+    if ( node->ToElement() ) {
+        return ArenaItemSize( sizeof( XMLElement ) );
+    }
+    if ( node->ToText() ) {
+        return ArenaItemSize( sizeof( XMLText ) );
+    }
+    if ( node->ToComment() ) {
+        return ArenaItemSize( sizeof( XMLComment ) );
+    }
+    if ( node->ToDeclaration() ) {
+        return ArenaItemSize( sizeof( XMLDeclaration ) );
+    }
+    return ArenaItemSize( sizeof( XMLUnknown ) );
+}
+
+
+XMLNode* XMLDocument::Relocate( XMLNode* node, char** cursor )
+{
+    XMLNode* copy = 0;
+    if ( XMLElement* ele = node->ToElement() ) {
+        XMLElement* to = new (*cursor) XMLElement( this );
+        *cursor += ArenaItemSize( sizeof( XMLElement ) );
+        to->_closingType = ele->_closingType;
+        XMLAttribute* last = 0;
+        for( XMLAttribute* a = ele->_rootAttribute; a; a = a->_next ) {
+            XMLAttribute* attrib = new (*cursor) XMLAttribute();
+            *cursor += ArenaItemSize( sizeof( XMLAttribute ) );
+            a->_name.TransferTo( &attrib->_name );
+            a->_value.TransferTo( &attrib->_value );
+            attrib->_parseLineNum = a->_parseLineNum;
+            attrib->_memPool = &_arenaPool;
+            if ( last ) {
+                last->_next = attrib;
+            }
+            else {
+                to->_rootAttribute = attrib;
+            }
+            last = attrib;
+        }
+        copy = to;
+    }
+    else if ( XMLText* text = node->ToText() ) {
+        XMLText* to = new (*cursor) XMLText( this );
+        *cursor += ArenaItemSize( sizeof( XMLText ) );
+        to->_isCData = text->_isCData;
+        copy = to;
+    }
+    else if ( node->ToComment() ) {
+        copy = new (*cursor) XMLComment( this );
+        *cursor += ArenaItemSize( sizeof( XMLComment ) );
+    }
+    else if ( node->ToDeclaration() ) {
+        copy = new (*cursor) XMLDeclaration( this );
+        *cursor += ArenaItemSize( sizeof( XMLDeclaration ) );
+    }
+    else {
+        TIXMLASSERT( node->ToUnknown() );
+        copy = new (*cursor) XMLUnknown( this );
+        *cursor += ArenaItemSize( sizeof( XMLUnknown ) );
+    }
+    node->_value.TransferTo( &copy->_value );
+    copy->_parseLineNum = node->_parseLineNum;
+    copy->_userData = node->_userData;
+    copy->_memPool = &_arenaPool;
+    return copy;
+}
+
+
+void XMLDocument::Finalize()
+{
+    // Size the block, walking the document without recursion; it can be deep.
+    size_t size = 0;
+    for( XMLNode* node = _firstChild; node; ) {
+        size += ArenaNodeSize( node );
+        if ( XMLElement* ele = node->ToElement() ) {
+            for( XMLAttribute* a = ele->_rootAttribute; a; a = a->_next ) {
+                size += ArenaItemSize( sizeof( XMLAttribute ) );
+            }
+        }
+        if ( node->_firstChild ) {
+            node = node->_firstChild;
+            continue;
+        }
+        while( node != this && !node->_next ) {
+            node = node->_parent;
+        }
+        node = ( node == this ) ? 0 : node->_next;
+    }
+    if ( size == 0 ) {
+        return;
+    }
+
+    char* arena = new char[size];
+    char* cursor = arena;
+    // Pairs of an old parent and its copy whose children are still to be
+    // placed. The last pushed is placed first, so the blocks of children
+    // follow each other in document order.
+    DynArray<XMLNode*, 32> pending;
+    DynArray<XMLNode*, 64> retired;
+    pending.Push( this );
+    pending.Push( this );
+    while( !pending.Empty() ) {
+        XMLNode* to = pending.Pop();
+        XMLNode* from = pending.Pop();
+        XMLNode* const first = from->_firstChild;
+        XMLNode* const last = from->_lastChild;
+        to->_firstChild = to->_lastChild = 0;
+        for( XMLNode* child = first; child; child = child->_next ) {
+            XMLNode* copy = Relocate( child, &cursor );
+            copy->_parent = to;
+            copy->_prev = to->_lastChild;
+            if ( to->_lastChild ) {
+                to->_lastChild->_next = copy;
+            }
+            else {
+                to->_firstChild = copy;
+            }
+            to->_lastChild = copy;
+            retired.Push( child );
+        }
+        for( XMLNode *child = last, *copy = to->_lastChild; child; child = child->_prev, copy = copy->_prev ) {
+            if ( child->_firstChild ) {
+                pending.Push( child );
+                pending.Push( copy );
+            }
+        }
+    }
+    TIXMLASSERT( cursor == arena + size );
+
+    // The old nodes are empty now: unlink them all and give them back.
+    for( int i = 0; i < retired.Size(); ++i ) {
+        XMLNode* node = retired[i];
+        node->_parent = node->_firstChild = node->_lastChild = node->_prev = node->_next = 0;
+        MemPool* pool = node->_memPool;
+        node->~XMLNode();
+        pool->Free( node );
+    }
+    delete [] _arena;
+    _arena = arena;
+}
+
+
 XMLComment* XMLDocument::NewComment( const char* str )
 {
     XMLComment* comment = CreateUnlinkedNode<XMLComment>( _commentPool );
@@ -2552,6 +2915,405 @@ void XMLDocument::PopDepth()
 	--_parsingDepth;
 }
 
+// --------- XMLCompactNode ----------- //
+
+int XMLCompactNode::Type() const
+{
+    TIXMLASSERT( _document );
+    return _document->_nodes[_index].type;
+}
+
+
+bool XMLCompactNode::IsElement() const
+{
+    return _document && _document->_nodes[_index].type == XMLCompactDocument::COMPACT_ELEMENT;
+}
+
+
+bool XMLCompactNode::IsText() const
+{
+    return _document && _document->_nodes[_index].type == XMLCompactDocument::COMPACT_TEXT;
+}
+
+
+const char* XMLCompactNode::Value() const
+{
+    TIXMLASSERT( _document );
+    return _document->String( _document->_nodes[_index].value );
+}
+
+
+XMLCompactNode XMLCompactNode::Parent() const
+{
+    if ( !_document ) {
+        return XMLCompactNode();
+    }
+    const unsigned parent = _document->_nodes[_index].parent;
+    return parent == XMLCompactDocument::NONE ? XMLCompactNode() : XMLCompactNode( _document, parent );
+}
+
+
+XMLCompactNode XMLCompactNode::FirstChild() const
+{
+    if ( !_document ) {
+        return XMLCompactNode();
+    }
+    const unsigned child = _document->_nodes[_index].firstChild;
+    return child == XMLCompactDocument::NONE ? XMLCompactNode() : XMLCompactNode( _document, child );
+}
+
+
+XMLCompactNode XMLCompactNode::NextSibling() const
+{
+    if ( !_document ) {
+        return XMLCompactNode();
+    }
+    const unsigned next = _document->_nodes[_index].next;
+    return next == XMLCompactDocument::NONE ? XMLCompactNode() : XMLCompactNode( _document, next );
+}
+
+
+XMLCompactNode XMLCompactNode::FirstChildElement( const char* name ) const
+{
+    for( XMLCompactNode node = FirstChild(); node; node = node.NextSibling() ) {
+        if ( node.IsElement() && ( !name || XMLUtil::StringEqual( node.Value(), name ) ) ) {
+            return node;
+        }
+    }
+    return XMLCompactNode();
+}
+
+
+XMLCompactNode XMLCompactNode::NextSiblingElement( const char* name ) const
+{
+    for( XMLCompactNode node = NextSibling(); node; node = node.NextSibling() ) {
+        if ( node.IsElement() && ( !name || XMLUtil::StringEqual( node.Value(), name ) ) ) {
+            return node;
+        }
+    }
+    return XMLCompactNode();
+}
+
+
+const char* XMLCompactNode::GetText() const
+{
+    const XMLCompactNode child = FirstChild();
+    return child.IsText() ? child.Value() : 0;
+}
+
+
+int XMLCompactNode::AttributeCount() const
+{
+    return _document ? static_cast<int>( _document->_nodes[_index].attributeCount ) : 0;
+}
+
+
+const char* XMLCompactNode::AttributeName( int i ) const
+{
+    TIXMLASSERT( i >= 0 && i < AttributeCount() );
+    const XMLCompactDocument::CompactNode& node = _document->_nodes[_index];
+    return _document->String( _document->_attributes[node.firstAttribute + i].name );
+}
+
+
+const char* XMLCompactNode::AttributeValue( int i ) const
+{
+    TIXMLASSERT( i >= 0 && i < AttributeCount() );
+    const XMLCompactDocument::CompactNode& node = _document->_nodes[_index];
+    return _document->String( _document->_attributes[node.firstAttribute + i].value );
+}
+
+
+const char* XMLCompactNode::Attribute( const char* name, const char* value ) const
+{
+    const int count = AttributeCount();
+    for( int i = 0; i < count; ++i ) {
+        if ( XMLUtil::StringEqual( AttributeName( i ), name ) ) {
+            const char* found = AttributeValue( i );
+            if ( !value || XMLUtil::StringEqual( found, value ) ) {
+                return found;
+            }
+            return 0;
+        }
+    }
+    return 0;
+}
+
+
+XMLError XMLCompactNode::QueryIntAttribute( const char* name, int* value ) const
+{
+    const char* str = Attribute( name );
+    if ( !str ) {
+        return XML_NO_ATTRIBUTE;
+    }
+    return XMLUtil::ToInt( str, value ) ? XML_SUCCESS : XML_WRONG_ATTRIBUTE_TYPE;
+}
+
+
+XMLError XMLCompactNode::QueryUnsignedAttribute( const char* name, unsigned* value ) const
+{
+    const char* str = Attribute( name );
+    if ( !str ) {
+        return XML_NO_ATTRIBUTE;
+    }
+    return XMLUtil::ToUnsigned( str, value ) ? XML_SUCCESS : XML_WRONG_ATTRIBUTE_TYPE;
+}
+
+
+XMLError XMLCompactNode::QueryInt64Attribute( const char* name, int64_t* value ) const
+{
+    const char* str = Attribute( name );
+    if ( !str ) {
+        return XML_NO_ATTRIBUTE;
+    }
+    return XMLUtil::ToInt64( str, value ) ? XML_SUCCESS : XML_WRONG_ATTRIBUTE_TYPE;
+}
+
+
+XMLError XMLCompactNode::QueryUnsigned64Attribute( const char* name, uint64_t* value ) const
+{
+    const char* str = Attribute( name );
+    if ( !str ) {
+        return XML_NO_ATTRIBUTE;
+    }
+    return XMLUtil::ToUnsigned64( str, value ) ? XML_SUCCESS : XML_WRONG_ATTRIBUTE_TYPE;
+}
+
+
+XMLError XMLCompactNode::QueryBoolAttribute( const char* name, bool* value ) const
+{
+    const char* str = Attribute( name );
+    if ( !str ) {
+        return XML_NO_ATTRIBUTE;
+    }
+    return XMLUtil::ToBool( str, value ) ? XML_SUCCESS : XML_WRONG_ATTRIBUTE_TYPE;
+}
+
+
+XMLError XMLCompactNode::QueryDoubleAttribute( const char* name, double* value ) const
+{
+    const char* str = Attribute( name );
+    if ( !str ) {
+        return XML_NO_ATTRIBUTE;
+    }
+    return XMLUtil::ToDouble( str, value ) ? XML_SUCCESS : XML_WRONG_ATTRIBUTE_TYPE;
+}
+
+
+XMLError XMLCompactNode::QueryFloatAttribute( const char* name, float* value ) const
+{
+    const char* str = Attribute( name );
+    if ( !str ) {
+        return XML_NO_ATTRIBUTE;
+    }
+    return XMLUtil::ToFloat( str, value ) ? XML_SUCCESS : XML_WRONG_ATTRIBUTE_TYPE;
+}
+
+
+int XMLCompactNode::GetLineNum() const
+{
+    if ( !_document || !_document->_keepLineNums ) {
+        return 0;
+    }
+    return _document->_lineNums[_index];
+}
+
+
+void* XMLCompactNode::GetUserData() const
+{
+    if ( !_document || !_document->_keepUserData ) {
+        return 0;
+    }
+    return _document->_userData[_index];
+}
+
+
+// --------- XMLCompactDocument ----------- //
+
+XMLCompactDocument::XMLCompactDocument( bool keepLineNums, bool keepUserData ) :
+    _keepLineNums( keepLineNums ),
+    _keepUserData( keepUserData ),
+    _errorID( XML_SUCCESS ),
+    _nodes(),
+    _attributes(),
+    _strings(),
+    _lineNums(),
+    _userData()
+{
+    Clear();
+}
+
+
+XMLCompactDocument::~XMLCompactDocument()
+{
+}
+
+
+void XMLCompactDocument::Clear()
+{
+    _nodes.Clear();
+    _attributes.Clear();
+    _strings.Clear();
+    _lineNums.Clear();
+    _userData.Clear();
+    _errorID = XML_SUCCESS;
+
+    // Offset 0 is the empty string, used for null values.
+    _strings.Push( 0 );
+    CompactNode* document = _nodes.PushArr( 1 );
+    document->value = 0;
+    document->parent = NONE;
+    document->firstChild = NONE;
+    document->next = NONE;
+    document->firstAttribute = 0;
+    document->attributeCount = 0;
+    document->type = COMPACT_DOCUMENT;
+    if ( _keepLineNums ) {
+        _lineNums.Push( 0 );
+    }
+    if ( _keepUserData ) {
+        _userData.Push( 0 );
+    }
+}
+
+
+unsigned XMLCompactDocument::AppendString( const char* str )
+{
+    if ( !str || !*str ) {
+        return 0;
+    }
+    const size_t len = strlen( str ) + 1;
+    TIXMLASSERT( len <= static_cast<size_t>( INT_MAX - _strings.Size() ) );
+    const unsigned offset = static_cast<unsigned>( _strings.Size() );
+    memcpy( _strings.PushArr( static_cast<int>( len ) ), str, len );
+    return offset;
+}
+
+
+unsigned XMLCompactDocument::AppendNode( const XMLNode* node, unsigned parent )
+{
+    const unsigned index = static_cast<unsigned>( _nodes.Size() );
+    CompactNode compact;
+    compact.value = AppendString( node->Value() );
+    compact.parent = parent;
+    compact.firstChild = NONE;
+    compact.next = NONE;
+    compact.firstAttribute = static_cast<unsigned>( _attributes.Size() );
+    compact.attributeCount = 0;
+    if ( node->ToElement() ) {
+        compact.type = COMPACT_ELEMENT;
+        for( const XMLAttribute* a = node->ToElement()->FirstAttribute(); a; a = a->Next() ) {
+            CompactAttribute attribute;
+            attribute.name = AppendString( a->Name() );
+            attribute.value = AppendString( a->Value() );
+            _attributes.Push( attribute );
+            ++compact.attributeCount;
+        }
+    }
+    else if ( node->ToText() ) {
+        compact.type = COMPACT_TEXT;
+    }
+    else if ( node->ToComment() ) {
+        compact.type = COMPACT_COMMENT;
+    }
+    else if ( node->ToDeclaration() ) {
+        compact.type = COMPACT_DECLARATION;
+    }
+    else {
+        compact.type = COMPACT_UNKNOWN;
+    }
+    _nodes.Push( compact );
+    if ( _keepLineNums ) {
+        _lineNums.Push( node->GetLineNum() );
+    }
+    if ( _keepUserData ) {
+        _userData.Push( node->GetUserData() );
+    }
+    return index;
+}
+
+
+void XMLCompactDocument::Build( const XMLDocument& document )
+{
+    Clear();
+    // Walk the document without recursion, it can be deep. 'parents' holds
+    // the compact index of each open ancestor and 'last' its last child so far.
+    DynArray<unsigned, 16> parents;
+    DynArray<unsigned, 16> last;
+    parents.Push( 0 );
+    last.Push( NONE );
+    const XMLNode* node = document.FirstChild();
+    while ( node ) {
+        const int top = parents.Size() - 1;
+        const unsigned index = AppendNode( node, parents[top] );
+        if ( last[top] == NONE ) {
+            _nodes[parents[top]].firstChild = index;
+        }
+        else {
+            _nodes[last[top]].next = index;
+        }
+        last[top] = index;
+
+        if ( node->FirstChild() ) {
+            parents.Push( index );
+            last.Push( NONE );
+            node = node->FirstChild();
+            continue;
+        }
+        while ( node != &document && !node->NextSibling() ) {
+            node = node->Parent();
+            parents.Pop();
+            last.Pop();
+        }
+        node = ( node == &document ) ? 0 : node->NextSibling();
+    }
+}
+
+
+XMLError XMLCompactDocument::Parse( const char* xml, size_t nBytes )
+{
+    XMLDocument scratch;
+    if ( scratch.Parse( xml, nBytes ) != XML_SUCCESS ) {
+        Clear();
+        _errorID = scratch.ErrorID();
+        return _errorID;
+    }
+    Build( scratch );
+    return _errorID;
+}
+
+
+XMLError XMLCompactDocument::LoadFile( const char* filename )
+{
+    XMLDocument scratch;
+    if ( scratch.LoadFile( filename ) != XML_SUCCESS ) {
+        Clear();
+        _errorID = scratch.ErrorID();
+        return _errorID;
+    }
+    Build( scratch );
+    return _errorID;
+}
+
+
+void XMLCompactDocument::SetUserData( XMLCompactNode node, void* userData )
+{
+    if ( _keepUserData && node._document == this ) {
+        _userData[node._index] = userData;
+    }
+}
+
+
+size_t XMLCompactDocument::MemoryUsage() const
+{
+    return sizeof( CompactNode ) * _nodes.Capacity()
+         + sizeof( CompactAttribute ) * _attributes.Capacity()
+         + _strings.Capacity()
+         + sizeof( int ) * _lineNums.Capacity()
+         + sizeof( void* ) * _userData.Capacity();
+}
+
+
 XMLPrinter::XMLPrinter( FILE* file, bool compact, int depth ) :
     _elementJustOpened( false ),
     _stack(),
@@ -458,6 +458,34 @@ private:
 };
 
 
+/*
+	The pool of the nodes XMLDocument::Finalize() places in one block. The
+	block is released as a whole with the document, so the nodes are never
+	handed out or given back one by one.
+*/
+class MemPoolArena : public MemPool
+{
+public:
+    MemPoolArena() {}
+
+    virtual int ItemSize() const	{
+        return 0;
+    }
+    virtual void* Alloc() {
+        TIXMLASSERT( false );
+        return 0;
+    }
+    virtual void Free( void* ) {
+    }
+    virtual void SetTracked() {
+    }
+
+private:
+    MemPoolArena( const MemPoolArena& ); // not supported
+    void operator=( const MemPoolArena& ); // not supported
+};
+
+
 
 /**
 	Implements the interface to the "Visitor pattern" (see the Accept() method.)
@@ -1140,6 +1168,7 @@ private:
 class TINYXML2_LIB XMLAttribute
 {
     friend class XMLElement;
+    friend class XMLDocument;
 public:
     /// The name of the attribute.
     const char* Name() const;
@@ -1914,6 +1943,42 @@ public:
 	*/
 	void DeepCopy(XMLDocument* target) const;
 
+	/**
+		Prepares this document to be moved under 'parent', an element of
+		another document, with AdoptChildren(). Every node is handed over to
+		the other document, the top level nodes get 'parent' as their parent
+		and 'lineOffset' is added to all the line numbers. It only writes to
+		the nodes of this document, so documents parsed in parallel can be
+		prepared on their own threads. Nothing but AdoptChildren() may be
+		called on this document afterwards.
+	*/
+	void PrepareAdoption( XMLNode* parent, int lineOffset );
+
+	/**
+		Moves the top level nodes of 'part', which was prepared with
+		PrepareAdoption(), to the end of their new parent in this document.
+		The nodes keep living in the memory of 'part', so this document takes
+		ownership of 'part' and deletes it after its own nodes on Clear().
+	*/
+	void AdoptChildren( XMLDocument* part );
+
+	/**
+		Moves every node and attribute of the document into one block of
+		memory laid out for reading: the children of a node are next to each
+		other in document order, each element directly followed by its
+		attributes, and the children of the first child come next. Walking
+		the document with FirstChildElement(), NextSiblingElement() and
+		FindAttribute() then reads memory in order instead of jumping between
+		pool blocks. Nodes created later come from the pools as usual, and
+		it can be called again after large edits.
+
+		Every node is moved to a new address and the old ones are freed, so
+		all the XMLNode, XMLElement, XMLText and XMLAttribute pointers (and
+		XMLHandles) obtained before the call are invalid afterwards. Look
+		them up again from the document.
+	*/
+	void Finalize();
+
 	// internal
     char* Identify( char* p, XMLNode** node );
 
@@ -1947,6 +2012,11 @@ private:
 	// in the document vs. a linked list in the XMLNode,
 	// and the performance is the same.
 	DynArray<XMLNode*, 10> _unlinked;
+	// Documents whose nodes were adopted; they own the memory of those nodes.
+	DynArray<XMLDocument*, 4> _adopted;
+	// The block of the nodes moved by Finalize().
+	char*			_arena;
+	MemPoolArena	_arenaPool;
 
     MemPoolT< sizeof(XMLElement) >	 _elementPool;
     MemPoolT< sizeof(XMLAttribute) > _attributePool;
@@ -1956,6 +2026,7 @@ private:
 	static const char* _errorNames[XML_ERROR_COUNT];
 
     void Parse();
+    XMLNode* Relocate( XMLNode* node, char** cursor );
 
     void SetError( XMLError error, int lineNum, const char* format, ... );
 
@@ -2192,6 +2263,235 @@ private:
 };
 
 
+class XMLCompactDocument;
+
+/**
+	A lightweight handle to a node of a XMLCompactDocument. It is a document pointer
+	and a 32 bit index, so it is cheap to copy; an empty handle is returned where
+	XMLNode would return a null pointer. Every string it returns points into the
+	document and is valid until the document is cleared or rebuilt.
+*/
+class TINYXML2_LIB XMLCompactNode
+{
+public:
+    XMLCompactNode() : _document( 0 ), _index( 0 ) {
+    }
+
+    /// True if this handle refers to a node.
+    operator bool() const						{
+        return _document != 0;
+    }
+
+    /// The type of the node, one of XMLCompactDocument::NodeType.
+    int Type() const;
+    bool IsElement() const;
+    bool IsText() const;
+
+    /// The value of the node: the element name, or the text, comment, declaration or unknown content.
+    const char* Value() const;
+    /// The name of an element, same as Value().
+    const char* Name() const						{
+        return Value();
+    }
+    /// Index of this node in the document, 0 is the document itself.
+    unsigned Index() const						{
+        return _index;
+    }
+
+    XMLCompactNode Parent() const;
+    XMLCompactNode FirstChild() const;
+    XMLCompactNode NextSibling() const;
+    /// The first child element, optionally with the given name.
+    XMLCompactNode FirstChildElement( const char* name = 0 ) const;
+    /// The next sibling element, optionally with the given name.
+    XMLCompactNode NextSiblingElement( const char* name = 0 ) const;
+
+    /// The text of the first child if it is a text node, as XMLElement::GetText().
+    const char* GetText() const;
+
+    /// The number of attributes of an element.
+    int AttributeCount() const;
+    /// The name of the i'th attribute, in document order.
+    const char* AttributeName( int i ) const;
+    /// The value of the i'th attribute, in document order.
+    const char* AttributeValue( int i ) const;
+    /** The value of the attribute with the given name, or null. If 'value' is
+        given, null is also returned when the attribute does not have that value,
+        as XMLElement::Attribute().
+    */
+    const char* Attribute( const char* name, const char* value = 0 ) const;
+
+    /// Convert an attribute, see XMLElement::QueryIntAttribute().
+    XMLError QueryIntAttribute( const char* name, int* value ) const;
+    XMLError QueryUnsignedAttribute( const char* name, unsigned* value ) const;
+    XMLError QueryInt64Attribute( const char* name, int64_t* value ) const;
+    XMLError QueryUnsigned64Attribute( const char* name, uint64_t* value ) const;
+    XMLError QueryBoolAttribute( const char* name, bool* value ) const;
+    XMLError QueryDoubleAttribute( const char* name, double* value ) const;
+    XMLError QueryFloatAttribute( const char* name, float* value ) const;
+
+	XMLError QueryAttribute( const char* name, int* value ) const {
+		return QueryIntAttribute( name, value );
+	}
+	XMLError QueryAttribute( const char* name, unsigned int* value ) const {
+		return QueryUnsignedAttribute( name, value );
+	}
+	XMLError QueryAttribute(const char* name, int64_t* value) const {
+		return QueryInt64Attribute(name, value);
+	}
+    XMLError QueryAttribute(const char* name, uint64_t* value) const {
+        return QueryUnsigned64Attribute(name, value);
+    }
+	XMLError QueryAttribute( const char* name, bool* value ) const {
+		return QueryBoolAttribute( name, value );
+	}
+	XMLError QueryAttribute( const char* name, double* value ) const {
+		return QueryDoubleAttribute( name, value );
+	}
+	XMLError QueryAttribute( const char* name, float* value ) const {
+		return QueryFloatAttribute( name, value );
+	}
+
+    /// The line number the node was parsed on, or 0 if the document does not keep them.
+    int GetLineNum() const;
+    /// The user data of the node, or null if the document does not keep it.
+    void* GetUserData() const;
+
+private:
+    friend class XMLCompactDocument;
+    XMLCompactNode( const XMLCompactDocument* document, unsigned index ) : _document( document ), _index( index ) {
+    }
+
+    const XMLCompactDocument* _document;
+    unsigned _index;
+};
+
+
+/**
+	A read-only copy of a document in a compact layout. A XMLDocument spends
+	around a hundred bytes on every node and every attribute: a vtable, the
+	links to its neighbours, a StrPair and a pool pointer, with the attributes
+	in their own linked list, and it keeps the whole parsed text. The compact
+	document keeps:
+	-# one array of nodes, linked by 32 bit indices, in document order
+	-# one array of attributes, those of an element next to each other
+	-# the decoded strings, one after the other in a single buffer
+	-# line numbers and user data only if asked for
+
+	It is built from a parsed XMLDocument, which can then be dropped, or
+	parsed directly through a scratch XMLDocument:
+
+	@verbatim
+	XMLCompactDocument doc;
+	doc.LoadFile( "input.xml" );
+	for( XMLCompactNode e = doc.RootElement().FirstChildElement( "item" ); e; e = e.NextSiblingElement( "item" ) ) {
+		e.QueryIntAttribute( "id", &id );
+	}
+	@endverbatim
+
+	The document can't be edited; build it again to change it.
+*/
+class TINYXML2_LIB XMLCompactDocument
+{
+    friend class XMLCompactNode;
+public:
+    enum NodeType {
+        COMPACT_DOCUMENT,
+        COMPACT_ELEMENT,
+        COMPACT_TEXT,
+        COMPACT_COMMENT,
+        COMPACT_DECLARATION,
+        COMPACT_UNKNOWN
+    };
+
+    /** Line numbers cost 4 bytes per node and user data a pointer per node,
+        so both are left out unless asked for.
+    */
+    XMLCompactDocument( bool keepLineNums = false, bool keepUserData = false );
+    ~XMLCompactDocument();
+
+    /** Copy the content of a document, which is not changed. The user data
+        of its nodes is copied if it is kept.
+    */
+    void Build( const XMLDocument& document );
+    /// Parse a string into a scratch XMLDocument and build from it, see XMLDocument::Parse().
+    XMLError Parse( const char* xml, size_t nBytes = static_cast<size_t>(-1) );
+    /// Load a file into a scratch XMLDocument and build from it, see XMLDocument::LoadFile().
+    XMLError LoadFile( const char* filename );
+    /// Drop the content.
+    void Clear();
+
+    /// The error of the last Parse() or LoadFile().
+    XMLError ErrorID() const				{
+        return _errorID;
+    }
+    bool Error() const						{
+        return _errorID != XML_SUCCESS;
+    }
+
+    /// The document node, index 0.
+    XMLCompactNode Document() const			{
+        return XMLCompactNode( this, 0 );
+    }
+    /// The first top level element, optionally with the given name.
+    XMLCompactNode RootElement( const char* name = 0 ) const {
+        return Document().FirstChildElement( name );
+    }
+    /// The node with the given index, or an empty handle.
+    XMLCompactNode Node( unsigned index ) const {
+        return index < NodeCount() ? XMLCompactNode( this, index ) : XMLCompactNode();
+    }
+
+    /// Set the user data of a node of this document. Does nothing if the document does not keep it.
+    void SetUserData( XMLCompactNode node, void* userData );
+
+    /// Number of nodes, including the document node.
+    unsigned NodeCount() const				{
+        return static_cast<unsigned>( _nodes.Size() );
+    }
+    unsigned AttributeCount() const			{
+        return static_cast<unsigned>( _attributes.Size() );
+    }
+    /// Bytes held by the arrays of the document.
+    size_t MemoryUsage() const;
+
+private:
+    XMLCompactDocument( const XMLCompactDocument& );	// not supported
+    void operator=( const XMLCompactDocument& );		// not supported
+
+    static const unsigned NONE = 0xffffffff;
+
+    struct CompactNode {
+        unsigned value;				// offset into _strings
+        unsigned parent;
+        unsigned firstChild;
+        unsigned next;
+        unsigned firstAttribute;	// index into _attributes
+        unsigned attributeCount : 28;
+        unsigned type : 4;
+    };
+    struct CompactAttribute {
+        unsigned name;
+        unsigned value;
+    };
+
+    unsigned AppendString( const char* str );
+    unsigned AppendNode( const XMLNode* node, unsigned parent );
+    const char* String( unsigned offset ) const {
+        return _strings.Mem() + offset;
+    }
+
+    bool _keepLineNums;
+    bool _keepUserData;
+    XMLError _errorID;
+    DynArray<CompactNode, 16> _nodes;
+    DynArray<CompactAttribute, 16> _attributes;
+    DynArray<char, 256> _strings;
+    DynArray<int, 1> _lineNums;				// per node, if kept
+    DynArray<void*, 1> _userData;			// per node, if kept
+};
+
+
 /**
 	Printing functionality. The XMLPrinter gives you more
 	options than the XMLDocument::Print() method.
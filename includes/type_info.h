@@ -2,15 +2,34 @@
 
 #include <string>
 #include <cstdlib>
+#include <cassert>
 #include <cxxabi.h>
 #include <functional>
 #include <memory>
 #include <vector>
+#include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <iostream>
+#include <stdexcept>
+#include <memory_resource>
+#include <optional>
+#include <iterator>
+#include <deque>
+#include <string_view>
 #include "type_mtr.h"
 #include "bin_srl.h"
 #include "tinyxml2.h"
 
+namespace bin_srl {
+    template<class T>
+    size_t serialized_size(const T& obj);
+    template<class T>
+    size_t skip_bin(std::istream& file);
+}
+
 /**
  * @brief contains the info of different types, especially for the user defined types. also there's a tiny reflection system.
  */
@@ -19,11 +38,22 @@ namespace type_info {
 // use macro to deal with the qualifiers
 #define RP(TYPE) typename std::remove_cv<typename std::remove_reference<TYPE>::type>::type
 
+    // the functions registered for a type, kept as plain pointers so a call is a single indirect call
+    typedef unsigned int (*writer_bin_fn)(const void *, std::ostream &);
+    typedef unsigned int (*reader_bin_fn)(void *, std::istream &);
+    typedef unsigned int (*writer_xml_fn)(const void *, const char *, tinyxml2::XMLElement *);
+    typedef unsigned int (*reader_xml_fn)(void *, const char *, tinyxml2::XMLElement *, int itself);
+    typedef size_t (*sizer_bin_fn)(const void *);
+    typedef size_t (*skipper_bin_fn)(std::istream &);
+
     /**
      * @brief store the members of a struct. At the meantime, it's an entry point for the registry of the members.
      * @param name the name of the member
      * @param typenm the type name of the member
      * @param offset the offset of the member
+     * @param size the size of the member
+     * @param plain if the binary encoding of the member is just its bytes
+     * The functions of the member type are looked up once, when the member is registered.
      */
     struct memberPair {
         template <typename T>
@@ -32,6 +62,14 @@ namespace type_info {
         std::string name;
         std::string typenm;
         size_t offset;
+        size_t size = 0;
+        bool plain = false;
+        writer_bin_fn writer_bin;
+        reader_bin_fn reader_bin;
+        writer_xml_fn writer_xml;
+        reader_xml_fn reader_xml;
+        sizer_bin_fn sizer_bin;
+        skipper_bin_fn skipper_bin;
     };
 
     /**
@@ -39,21 +77,113 @@ namespace type_info {
      * @param name the name of the struct
      * @param typenm the type name of the struct
      * @param members the members of the struct
+     * @param plain if the struct is trivially copyable and its members cover it in order with no padding,
+     *              then its binary encoding is just its bytes and it is copied as one block
      */
     struct typeInfo {
         std::string name;
         std::string typenm;
         std::vector<memberPair> members;
+        bool plain = false;
     };
+
+    /**
+     * @brief a table keyed by type name, written while types are registered and read while serializing
+     * New entries go into a staging map under a lock. freeze() publishes an
+     * immutable copy of it, which lookups read without taking a lock or
+     * writing to shared memory, so any number of threads can serialize at
+     * once. Entries added after the last freeze() are still found, through
+     * the lock. Entries are never removed or replaced and every published
+     * copy is kept, so the references handed out stay valid.
+     */
+    template <typename V>
+    class registry {
+    public:
+        typedef std::unordered_map<std::string, V> map_type;
+
+        registry() : frozen_(nullptr), dirty_(false) {}
+        registry(const registry &) = delete;
+        registry &operator=(const registry &) = delete;
+
+        // the entry of key, nullptr if there is none
+        const V *find(const std::string &key) const {
+            const map_type *frozen = frozen_.load(std::memory_order_acquire);
+            if (frozen != nullptr) {
+                auto it = frozen->find(key);
+                if (it != frozen->end()) return &it->second;
+                if (!dirty_.load(std::memory_order_acquire)) return nullptr;
+            }
+            std::lock_guard<std::mutex> guard(lock_);
+            auto it = staging_.find(key);
+            return it == staging_.end() ? nullptr : &it->second;
+        }
+
+        bool contains(const std::string &key) const {
+            return find(key) != nullptr;
+        }
+
+        // the entry of key, throws if there is none
+        const V &at(const std::string &key) const {
+            const V *value = find(key);
+            if (value == nullptr) {
+                std::cerr << "type " << key << " not registered" << std::endl;
+                throw std::runtime_error("type not registered");
+            }
+            return *value;
+        }
+
+        // add an entry unless key already has one
+        bool insert(const std::string &key, V value) {
+            std::lock_guard<std::mutex> guard(lock_);
+            bool added = staging_.emplace(key, std::move(value)).second;
+            if (added) dirty_.store(true, std::memory_order_release);
+            return added;
+        }
+
+        // publish the entries added so far for lock-free lookup
+        void freeze() {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (!dirty_.load(std::memory_order_relaxed)) return;
+            published_.emplace_back(new map_type(staging_));
+            frozen_.store(published_.back().get(), std::memory_order_release);
+            dirty_.store(false, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<const map_type *> frozen_;
+        std::atomic<bool> dirty_;
+        mutable std::mutex lock_;
+        map_type staging_;
+        std::vector<std::unique_ptr<const map_type>> published_;
+    };
+
     // the registry of the types
-    std::unordered_map<std::string, typeInfo> typeInfo_map;
-    std::unordered_map<std::string, std::string> type_name_map;
+    inline registry<typeInfo> typeInfo_map;
+    inline registry<std::string> type_name_map;
 
     // these maps store the functions we need for write and read
-    std::unordered_map<std::string, std::function<unsigned int(const void*, std::ostream &)> > type_writer_bin;
-    std::unordered_map<std::string, std::function<unsigned int(void*, std::istream &)> > type_reader_bin;
-    std::unordered_map<std::string, std::function<unsigned int(const void*, std::string, tinyxml2::XMLElement *)> > type_writer_xml;
-    std::unordered_map<std::string, std::function<unsigned int(void*, std::string, tinyxml2::XMLElement *, int itself)> > type_reader_xml;
+    inline registry<writer_bin_fn> type_writer_bin;
+    inline registry<reader_bin_fn> type_reader_bin;
+    inline registry<writer_xml_fn> type_writer_xml;
+    inline registry<reader_xml_fn> type_reader_xml;
+    inline registry<sizer_bin_fn> type_sizer_bin;
+    inline registry<skipper_bin_fn> type_skipper_bin;
+
+    /**
+     * @brief publish every type registered so far for lock-free lookup
+     * Call it once the types are registered, before serializing from several
+     * threads. The parallel entry points of bin_srl and xml_srl call it too.
+     */
+    inline void freeze() {
+        typeInfo_map.freeze();
+        type_name_map.freeze();
+        type_writer_bin.freeze();
+        type_reader_bin.freeze();
+        type_writer_xml.freeze();
+        type_reader_xml.freeze();
+        type_sizer_bin.freeze();
+        type_skipper_bin.freeze();
+    }
 
     // demangle the type name from an object
     template <typename T>
@@ -77,11 +207,730 @@ namespace type_info {
         return ret;
     }
 
+    /**
+     * @brief the registered functions and info of the type T, resolved once per type
+     * The first call looks T up by its type name and keeps the result, so the
+     * writers and readers of containers and structs call their children
+     * without any string work per element. Entries are never replaced, which
+     * keeps the results right for good. A lookup of a type that is not
+     * registered throws, and is tried again on the next call.
+     */
+    template <typename T>
+    struct dispatch {
+        static const std::string &type_name() {
+            static const std::string typenm = demangle_ind(typeid(T).name());
+            return typenm;
+        }
+        // a stable id of T, the 64 bit FNV-1a hash of its type name
+        static uint64_t id() {
+            static const uint64_t id = [] {
+                uint64_t hash = 14695981039346656037ull;
+                for (unsigned char c : type_name()) {
+                    hash = (hash ^ c) * 1099511628211ull;
+                }
+                return hash;
+            }();
+            return id;
+        }
+        static writer_bin_fn writer_bin() {
+            static const writer_bin_fn fn = type_writer_bin.at(type_name());
+            return fn;
+        }
+        static reader_bin_fn reader_bin() {
+            static const reader_bin_fn fn = type_reader_bin.at(type_name());
+            return fn;
+        }
+        static writer_xml_fn writer_xml() {
+            static const writer_xml_fn fn = type_writer_xml.at(type_name());
+            return fn;
+        }
+        static reader_xml_fn reader_xml() {
+            static const reader_xml_fn fn = type_reader_xml.at(type_name());
+            return fn;
+        }
+        static sizer_bin_fn sizer_bin() {
+            static const sizer_bin_fn fn = type_sizer_bin.at(type_name());
+            return fn;
+        }
+        static skipper_bin_fn skipper_bin() {
+            static const skipper_bin_fn fn = type_skipper_bin.at(type_name());
+            return fn;
+        }
+        // the info of a registered struct
+        static const typeInfo &info() {
+            static const typeInfo &info = typeInfo_map.at(type_name());
+            return info;
+        }
+        // the calling name of a registered struct
+        static const char *name() {
+            static const char *name = type_name_map.at(type_name()).c_str();
+            return name;
+        }
+    };
+
+    /**
+     * @brief if the binary encoding of a T is just its bytes
+     * True for arithmetic types, arrays of them and plain registered structs.
+     * A run of such values is written and read as one block, which gives the
+     * same bytes as writing them one by one.
+     */
+    template <typename T>
+    bool is_plain() {
+        if constexpr (std::is_arithmetic<T>::value) {
+            return true;
+        } else if constexpr (std::is_array<T>::value) {
+            return is_plain<typename std::remove_all_extents<T>::type>();
+        } else if constexpr (std::is_class<T>::value && std::is_trivially_copyable<T>::value &&
+                             !my_type_traits::is_pair<T>::value) {
+            return dispatch<T>::info().plain;
+        } else {
+            return false;
+        }
+    }
+
+    // write n plain values as one block
+    template <typename T>
+    unsigned int write_block(const T *data, size_t n, std::ostream &file) {
+        file.write(reinterpret_cast<const char *>(data), n * sizeof(T));
+        return (unsigned int)(n * sizeof(T));
+    }
+
+    // read cnt plain values as blocks and add them to the end of a vector
+    template <typename C>
+    unsigned int read_block(C &cont, unsigned int cnt, std::istream &file) {
+        const size_t step = 1 << 16;                        // grow step by step, a broken count stops at the end of the file
+        for (size_t done = 0; done < cnt && file; ) {
+            size_t n = std::min<size_t>(step, cnt - done), old = cont.size();
+            cont.resize(old + n);
+            file.read(reinterpret_cast<char *>(cont.data() + old), n * sizeof(typename C::value_type));
+            done += n;
+        }
+        return (unsigned int)(cnt * sizeof(typename C::value_type));
+    }
+
+    // the memory resource the objects raw pointers point to are read into on this thread, nullptr for new
+    inline thread_local std::pmr::memory_resource *target_resource = nullptr;
+
+    /**
+     * @brief while alive, the objects raw pointers point to are read into resource on this thread
+     * They are not to be deleted, they go away with the resource.
+     */
+    class resource_scope {
+    public:
+        explicit resource_scope(std::pmr::memory_resource *resource) : saved_(target_resource) {
+            target_resource = resource;
+        }
+        ~resource_scope() {
+            target_resource = saved_;
+        }
+        resource_scope(const resource_scope &) = delete;
+        resource_scope &operator=(const resource_scope &) = delete;
+
+    private:
+        std::pmr::memory_resource *saved_;
+    };
+
+    /**
+     * @brief a default value to read an element into, built with the allocator of its container when it takes one
+     * Such a value moves into a std::pmr container without being copied to another memory resource.
+     */
+    template <typename V, typename A>
+    V make_element(const A &alloc) {
+        if constexpr (my_type_traits::is_pair<V>::value) {
+            return V(make_element<typename V::first_type>(alloc), make_element<typename V::second_type>(alloc));
+        } else if constexpr (std::uses_allocator<V, A>::value && std::is_constructible<V, const A &>::value) {
+            return V(alloc);
+        } else {
+            return V();
+        }
+    }
+
+    // the allocator the elements of a container are built with, adaptors do not expose theirs
+    template <typename C>
+    auto allocator_of(const C &cont) {
+        if constexpr (my_type_traits::is_container_adaptor<C>::value) {
+            return std::allocator<char>();
+        } else {
+            return cont.get_allocator();
+        }
+    }
+
+    // a new object for a raw pointer to point to, from target_resource if there is one
+    template <typename T>
+    T *new_target() {
+        if (target_resource == nullptr) {
+            return new T();
+        }
+        void *mem = target_resource->allocate(sizeof(T), alignof(T));
+        return new (mem) T(make_element<T>(std::pmr::polymorphic_allocator<char>(target_resource)));
+    }
+
+    // ordered sets and maps of integers are written and read with packed keys on this thread
+    inline thread_local bool packed_keys = false;
+
+    /**
+     * @brief while alive, ordered sets and maps of integers are written and read with packed keys on this thread
+     * The files written this way are only read back in such a scope.
+     */
+    class packed_scope {
+    public:
+        explicit packed_scope(bool packed = true) : saved_(packed_keys) {
+            packed_keys = packed;
+        }
+        ~packed_scope() {
+            packed_keys = saved_;
+        }
+        packed_scope(const packed_scope &) = delete;
+        packed_scope &operator=(const packed_scope &) = delete;
+
+    private:
+        bool saved_;
+    };
+
+    // strings are written and read through a dictionary on this thread
+    inline thread_local bool string_dictionary = false;
+
+    /**
+     * @brief while alive, strings are written and read through a dictionary on this thread
+     * The files written this way are only read back in such a scope.
+     */
+    class dictionary_scope {
+    public:
+        explicit dictionary_scope(bool dictionary = true) : saved_(string_dictionary) {
+            string_dictionary = dictionary;
+        }
+        ~dictionary_scope() {
+            string_dictionary = saved_;
+        }
+        dictionary_scope(const dictionary_scope &) = delete;
+        dictionary_scope &operator=(const dictionary_scope &) = delete;
+
+    private:
+        bool saved_;
+    };
+
+    // the modes of a thread that the workers of a parallel read or write take over
+    struct thread_modes {
+        std::pmr::memory_resource *resource;
+        bool packed;
+        bool dictionary;
+    };
+
+    // the modes of this thread, to hand to the workers
+    inline thread_modes current_modes() {
+        return {target_resource, packed_keys, string_dictionary};
+    }
+
+    /**
+     * @brief while alive, this thread works in the modes of another one
+     * Opened by every worker of a parallel read or write, so the work is done
+     * as the calling thread would do it.
+     */
+    class modes_scope {
+    public:
+        explicit modes_scope(const thread_modes &modes) : resource_(modes.resource), packed_(modes.packed), dictionary_(modes.dictionary) {}
+        modes_scope(const modes_scope &) = delete;
+        modes_scope &operator=(const modes_scope &) = delete;
+
+    private:
+        resource_scope resource_;
+        packed_scope packed_;
+        dictionary_scope dictionary_;
+    };
+
+    // if the keys of a T can be packed, it is an ordered set or map of integers
+    template <typename T>
+    constexpr bool packable() {
+        if constexpr (my_type_traits::is_ordered<T>::value) {
+            typedef typename std::remove_cv<typename T::key_type>::type key_type;
+            return std::is_integral<key_type>::value && !std::is_same<key_type, bool>::value;
+        } else {
+            return false;
+        }
+    }
+
+    // the layouts of the entries of a container with packable keys
+    enum key_layout : unsigned char {
+        keys_plain = 0,                                 // as write_bin writes them
+        keys_delta = 1                                  // the steps between the keys as varints, then the values
+    };
+
+    // the key of an entry of a set or a map
+    template <typename V>
+    const auto &key_of(const V &entry) {
+        if constexpr (my_type_traits::is_pair<V>::value) {
+            return entry.first;
+        } else {
+            return entry;
+        }
+    }
+
+    // the zigzag of the step between two keys, in 64-bit modular arithmetic, so any integer type and order works
+    inline uint64_t key_step_(uint64_t prev, uint64_t cur) {
+        uint64_t d = cur - prev;
+        return (d << 1) ^ (uint64_t)((int64_t)d >> 63);
+    }
+
+    // the number of bytes the keys of cont take as varint steps
+    template <typename T>
+    size_t packed_key_bytes(const T &cont) {
+        size_t bytes = 0;
+        uint64_t prev = 0;
+        for (const auto &entry : cont) {
+            uint64_t cur = (uint64_t)key_of(entry), step = key_step_(prev, cur);
+            do {
+                ++ bytes;
+                step >>= 7;
+            } while (step != 0);
+            prev = cur;
+        }
+        return bytes;
+    }
+
+    // if the keys of cont are smaller as varint steps, bytes is set to their size
+    template <typename T>
+    bool keys_delta_smaller(const T &cont, size_t &bytes) {
+        bytes = packed_key_bytes(cont);
+        return bytes + sizeof(unsigned int) < cont.size() * sizeof(typename T::key_type);
+    }
+
+    /**
+     * @brief write the entries of a container with packable keys, after its count
+     * A layout byte comes first. Then the entries are written as write_bin
+     * writes them, or, when that is smaller, the byte count and the varint
+     * steps of the keys, followed by the values of a map in order.
+     * @param cont
+     * @param file
+     * @param write_value writes a mapped value and returns its size
+     * @return the output size of binary data
+     */
+    template <typename T, typename F>
+    unsigned int write_packed(const T &cont, std::ostream &file, F write_value) {
+        typedef typename std::remove_cv<typename T::key_type>::type key_type;
+        size_t bytes = 0;
+        unsigned char layout = keys_delta_smaller(cont, bytes) ? keys_delta : keys_plain;
+        file.put((char)layout);
+        unsigned int size = 1;
+        if (layout == keys_plain) {
+            for (const auto &entry : cont) {
+                file.write(reinterpret_cast<const char *>(&key_of(entry)), sizeof(key_type));
+                size += sizeof(key_type);
+                if constexpr (my_type_traits::is_map<T>::value) size += write_value(entry.second);
+            }
+            return size;
+        }
+        std::string buf(bytes, '\0');
+        size_t at = 0;
+        uint64_t prev = 0;
+        for (const auto &entry : cont) {
+            uint64_t cur = (uint64_t)key_of(entry), step = key_step_(prev, cur);
+            for (; step >= 0x80; step >>= 7) {
+                buf[at ++] = (char)(step | 0x80);
+            }
+            buf[at ++] = (char)step;
+            prev = cur;
+        }
+        unsigned int len = (unsigned int)bytes;
+        file.write(reinterpret_cast<const char *>(&len), sizeof(len));
+        file.write(buf.data(), bytes);
+        size += sizeof(len) + len;
+        if constexpr (my_type_traits::is_map<T>::value) {
+            for (const auto &entry : cont) {
+                size += write_value(entry.second);
+            }
+        }
+        return size;
+    }
+
+    // write the keys of a set, which has no values
+    template <typename T>
+    unsigned int write_packed(const T &cont, std::ostream &file) {
+        static_assert(!my_type_traits::is_map<T>::value, "the values of a map need a writer");
+        return write_packed(cont, file, [](const auto &) -> unsigned int { return 0; });
+    }
+
+    // report a broken run of packed keys
+    inline void packed_keys_error_() {
+        std::cerr << "Invalid packed keys" << std::endl;
+        throw std::runtime_error("Invalid packed keys");
+    }
+
+    /**
+     * @brief read cnt entries written by write_packed and add them to the container
+     * @param cont
+     * @param cnt the number of entries
+     * @param file
+     * @param read_value reads a mapped value and returns its size
+     * @return the input size of binary data
+     */
+    template <typename T, typename F>
+    unsigned int read_packed(T &cont, unsigned int cnt, std::istream &file, F read_value) {
+        typedef typename std::remove_cv<typename T::key_type>::type key_type;
+        auto add = [&](key_type key, unsigned int &size) {
+            if constexpr (my_type_traits::is_map<T>::value) {
+                auto value = make_element<typename std::remove_cv<typename T::mapped_type>::type>(allocator_of(cont));
+                size += read_value(value);
+                cont.emplace_hint(cont.end(), key, std::move(value));
+            } else {
+                cont.emplace_hint(cont.end(), key);
+            }
+        };
+        int layout = file.get();
+        unsigned int size = 1;
+        if (layout == keys_plain) {
+            for (unsigned int i = 0; i < cnt && file; ++ i) {
+                key_type key{};
+                file.read(reinterpret_cast<char *>(&key), sizeof(key_type));
+                size += sizeof(key_type);
+                add(key, size);
+            }
+            return size;
+        }
+        unsigned int len = 0;
+        file.read(reinterpret_cast<char *>(&len), sizeof(len));
+        if (layout != keys_delta || !file || cnt > len || len > (uint64_t)cnt * 10) {     // every step takes 1 to 10 bytes
+            packed_keys_error_();
+        }
+        std::string buf(len, '\0');
+        file.read(&buf[0], len);
+        size += sizeof(len) + len;
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(buf.data()), *end = p + len;
+        std::vector<key_type> keys(cnt);
+        uint64_t prev = 0;
+        for (unsigned int i = 0; i < cnt; ++ i) {
+            uint64_t step = 0;
+            unsigned int shift = 0;
+            unsigned char byte;
+            do {
+                if (p == end || shift > 63) packed_keys_error_();
+                byte = *p ++;
+                step |= (uint64_t)(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            prev += (step >> 1) ^ (0 - (step & 1));
+            keys[i] = (key_type)prev;
+        }
+        if (!file || p != end) {
+            packed_keys_error_();
+        }
+        for (key_type key : keys) {
+            add(key, size);
+        }
+        return size;
+    }
+
+    // read the keys of a set, which has no values
+    template <typename T>
+    unsigned int read_packed(T &cont, unsigned int cnt, std::istream &file) {
+        static_assert(!my_type_traits::is_map<T>::value, "the values of a map need a reader");
+        return read_packed(cont, cnt, file, [](auto &) -> unsigned int { return 0; });
+    }
+
+    // the strings met through the dictionary while one value is written or read
+    struct string_table {
+        std::deque<std::string> strings;                                               // by id - 1
+        std::unordered_map<std::string_view, unsigned int> ids;                        // the ids of the strings written, viewing strings
+    };
+
+    /**
+     * @brief the objects met through raw and shared pointers while one value is written or read
+     * An object gets the next id the first time a pointer to it is met and is
+     * written after that id. Later pointers to it are written as the id alone,
+     * so shared objects are written once and cycles end. Raw and shared
+     * pointers have ids of their own, an object is told apart by its address
+     * and its type.
+     */
+    struct identity_table {
+        typedef std::pair<const void *, const void *> key_type;                        // the address and the type of an object
+        struct key_hash {
+            size_t operator()(const key_type &key) const {
+                return std::hash<const void *>()(key.first) * 31 + std::hash<const void *>()(key.second);
+            }
+        };
+        std::unordered_map<key_type, unsigned int, key_hash> written[2];               // the ids of the objects written, [1] for shared ones
+        std::vector<key_type> read[2];                                                 // the objects read, by id - 1
+        std::vector<std::shared_ptr<void>> owners;                                     // the shared objects read, by id - 1
+        std::unique_ptr<string_table> strings;                                         // the strings met through the dictionary, made on first use
+    };
+
+    // the identity table of the write, read or size pass running on this thread
+    inline thread_local identity_table *identities = nullptr;
+
+    /**
+     * @brief gives the outermost write, read or size pass on this thread an identity table, the passes nested in it share it
+     * @param track false for the types that hold no pointers, which need no table
+     */
+    class identity_scope {
+    public:
+        explicit identity_scope(bool track = true) : owned_(track && identities == nullptr) {
+            if (owned_) {
+                table_.emplace();
+                identities = &*table_;
+            }
+        }
+        // run the passes in this scope on table, so one pass can be carried on over several calls
+        explicit identity_scope(identity_table &table) : owned_(true), saved_(identities) {
+            identities = &table;
+        }
+        ~identity_scope() {
+            if (owned_) identities = saved_;
+        }
+        identity_scope(const identity_scope &) = delete;
+        identity_scope &operator=(const identity_scope &) = delete;
+
+    private:
+        bool owned_;
+        identity_table *saved_ = nullptr;
+        std::optional<identity_table> table_;
+    };
+
+    // the type a raw or shared pointer of type P points to
+    template <typename P>
+    using target_of = RP(decltype(*std::declval<P>()));
+
+    /**
+     * @brief give the object a raw or shared pointer points to an id
+     * @param ptr
+     * @param ref set to the id, 0 for nullptr
+     * @return true if the object is met for the first time and has to be written after the id
+     */
+    template <typename P>
+    bool track_written(const P &ptr, unsigned int &ref) {
+        if (ptr == nullptr) {
+            ref = 0;
+            return false;
+        }
+        auto &ids = identities->written[my_type_traits::is_shared_ptr<P>::value];
+        identity_table::key_type key(&*ptr, &typeid(target_of<P>));
+        auto found = ids.emplace(key, (unsigned int)ids.size() + 1);
+        ref = found.first->second;
+        return found.second;
+    }
+
+    // the id the next new object read for a pointer of type P gets
+    template <typename P>
+    unsigned int next_read_id() {
+        return (unsigned int)identities->read[my_type_traits::is_shared_ptr<P>::value].size() + 1;
+    }
+
+    // a new object for a pointer of type P to point to, remembered under the next id. It is read after this.
+    template <typename P>
+    auto track_new() {
+        typedef target_of<P> target;
+        if constexpr (my_type_traits::is_shared_ptr<P>::value) {
+            std::shared_ptr<target> obj = target_resource == nullptr ? std::make_shared<target>() :
+                std::allocate_shared<target>(std::pmr::polymorphic_allocator<target>(target_resource));
+            identities->read[1].emplace_back(obj.get(), &typeid(target));
+            identities->owners.push_back(obj);
+            return obj;
+        } else {
+            target *obj = new_target<target>();
+            identities->read[0].emplace_back(obj, &typeid(target));
+            return obj;
+        }
+    }
+
+    // pass over the next id for a pointer of type P, its object is skipped and must not be referred to
+    template <typename P>
+    void track_skipped() {
+        constexpr bool shared = my_type_traits::is_shared_ptr<P>::value;
+        identities->read[shared].emplace_back(nullptr, &typeid(target_of<P>));
+        if (shared) identities->owners.emplace_back();
+    }
+
+    // pass over the ids in front of id, an object written with its id may follow skipped ones
+    template <typename P>
+    void skip_to_id(unsigned int id) {
+        while (next_read_id<P>() < id) {
+            track_skipped<P>();
+        }
+    }
+
+    // the object read earlier under ref for a pointer of type P
+    template <typename P>
+    P tracked(unsigned int ref) {
+        typedef target_of<P> target;
+        constexpr bool shared = my_type_traits::is_shared_ptr<P>::value;
+        const auto &objects = identities->read[shared];
+        if (ref == 0 || ref > objects.size() || objects[ref - 1].second != &typeid(target)) {
+            std::cerr << "invalid object reference " << ref << std::endl;
+            throw std::runtime_error("invalid object reference");
+        }
+        if (objects[ref - 1].first == nullptr) {
+            std::cerr << "reference " << ref << " to an object that was skipped" << std::endl;
+            throw std::runtime_error("reference to a skipped object");
+        }
+        if constexpr (shared) {
+            return std::static_pointer_cast<target>(identities->owners[ref - 1]);
+        } else {
+            return static_cast<target *>(const_cast<void *>(objects[ref - 1].first));
+        }
+    }
+
+    // the raw pointer of a raw or shared pointer
+    template <typename P>
+    auto raw_pointer(const P &ptr) {
+        if constexpr (std::is_pointer<P>::value) {
+            return ptr;
+        } else {
+            return ptr.get();
+        }
+    }
+
+    // the string dictionary of the pass
+    inline string_table &strings_() {
+        if (!identities->strings) {
+            identities->strings.reset(new string_table());
+        }
+        return *identities->strings;
+    }
+
+    // the id of str in the dictionary of the pass, fresh is true if it is met for the first time and entered
+    inline unsigned int string_id_(std::string_view str, bool &fresh) {
+        string_table &table = strings_();
+        auto found = table.ids.find(str);
+        fresh = found == table.ids.end();
+        if (!fresh) {
+            return found->second;
+        }
+        table.strings.emplace_back(str);
+        unsigned int ref = (unsigned int)table.strings.size();
+        table.ids.emplace(table.strings.back(), ref);
+        return ref;
+    }
+
+    /**
+     * @brief write a string through the dictionary of the pass
+     * A string met for the first time gets the next id and is written after
+     * it, later equal strings are written as the id alone.
+     * @param str
+     * @param file
+     * @return the output size of binary data
+     */
+    template <typename S>
+    unsigned int write_dictionary_string(const S &str, std::ostream &file) {
+        identity_scope identity;
+        bool fresh = false;
+        unsigned int ref = string_id_(std::string_view(str.data(), str.size()), fresh);
+        file.write(reinterpret_cast<const char *>(&ref), sizeof(ref));
+        if (!fresh) {
+            return sizeof(ref);
+        }
+        unsigned int len = (unsigned int)str.size();
+        file.write(reinterpret_cast<const char *>(&len), sizeof(len));
+        file.write(str.data(), len);
+        return sizeof(ref) + sizeof(len) + len;
+    }
+
+    // the size write_dictionary_string gives for str, which is entered in the dictionary the same way
+    template <typename S>
+    size_t dictionary_string_size(const S &str) {
+        identity_scope identity;
+        bool fresh = false;
+        string_id_(std::string_view(str.data(), str.size()), fresh);
+        return fresh ? 2 * sizeof(unsigned int) + str.size() : sizeof(unsigned int);
+    }
+
+    /**
+     * @brief read a string written by write_dictionary_string
+     * Every distinct string is read once and kept in the dictionary, the
+     * later ones are copied from it.
+     * @param str
+     * @param file
+     * @return the input size of binary data
+     */
+    template <typename S>
+    unsigned int read_dictionary_string(S &str, std::istream &file) {
+        identity_scope identity;
+        std::deque<std::string> &strings = strings_().strings;
+        unsigned int ref = 0, len = 0;
+        file.read(reinterpret_cast<char *>(&ref), sizeof(ref));
+        if (file && ref == strings.size() + 1) {                                       // a new string
+            file.read(reinterpret_cast<char *>(&len), sizeof(len));
+            strings.emplace_back(len, '\0');
+            file.read(&strings.back()[0], len);
+            str.assign(strings.back().data(), len);
+            return 2 * sizeof(unsigned int) + len;
+        }
+        if (ref == 0 || ref > strings.size()) {
+            std::cerr << "invalid string reference " << ref << std::endl;
+            throw std::runtime_error("invalid string reference");
+        }
+        str.assign(strings[ref - 1].data(), strings[ref - 1].size());
+        return sizeof(ref);
+    }
+
+    /**
+     * @brief an input iterator over the elements a sequence reader yields one at a time
+     * Reader has a value_type and a bool next(value_type &) which gives the
+     * next element and returns false after the last one. A default constructed
+     * iterator is the end.
+     */
+    template <typename Reader>
+    class sequence_iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef typename Reader::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+        sequence_iterator() = default;
+        explicit sequence_iterator(Reader *reader) : reader_(reader) {
+            ++ *this;
+        }
+        reference operator*() const { return value_; }
+        pointer operator->() const { return &value_; }
+        sequence_iterator &operator++() {
+            if (!reader_->next(value_)) reader_ = nullptr;
+            return *this;
+        }
+        void operator++(int) { ++ *this; }
+        bool operator==(const sequence_iterator &other) const { return reader_ == other.reader_; }
+        bool operator!=(const sequence_iterator &other) const { return reader_ != other.reader_; }
+
+    private:
+        Reader *reader_ = nullptr;
+        value_type value_{};
+    };
+
+    /**
+     * @brief the paths under member of a projection
+     * @param paths the member paths of a projection, names joined by '.'
+     * @param member
+     * @param sub set to the rest of the paths that go into member
+     * @return true if the whole member is wanted
+     */
+    inline bool project_member(const std::vector<std::string> &paths, const std::string &member, std::vector<std::string> &sub) {
+        sub.clear();
+        for (const auto &path : paths) {
+            if (path == member) {
+                return true;
+            }
+            if (path.size() > member.size() && path.compare(0, member.size(), member) == 0 && path[member.size()] == '.') {
+                sub.push_back(path.substr(member.size() + 1));
+            }
+        }
+        return false;
+    }
+
+    // check that every path of a projection starts with a member of info
+    inline void check_projection(const std::vector<std::string> &paths, const typeInfo &info) {
+        for (const auto &path : paths) {
+            std::string name = path.substr(0, path.find('.'));
+            if (std::none_of(info.members.begin(), info.members.end(),
+                             [&](const memberPair &m) { return m.name == name; })) {
+                std::cerr << "No member " << name << " in " << info.name << std::endl;
+                throw std::runtime_error("No such member");
+            }
+        }
+    }
+
     // get the calling name by its type name
     template <typename T>
     char *GetName(const T &x) {
-        if(type_name_map.find(demangle(x)) != type_name_map.end()) {
-            return const_cast<char *>(type_name_map[demangle(x)].c_str());
+        if(type_name_map.contains(demangle(x))) {
+            return const_cast<char *>(type_name_map.at(demangle(x)).c_str());
         } else {
             return const_cast<char *>(demangle(x).c_str());
         }
@@ -93,162 +942,216 @@ namespace type_info {
     template <typename T>
     void RegisterWriter_(const T &x) {
         std::string typenm = type_info::demangle_ind(typeid(RP(T)).name());
-        if (type_writer_bin.find(typenm) != type_writer_bin.end()) {
+        if (type_writer_bin.contains(typenm)) {
             return;
         }
+        type_sizer_bin.insert(typenm, [](const void *obj) -> size_t {                                           // register binary sizer
+            return bin_srl::serialized_size(*reinterpret_cast<const T *>(obj));
+        });
         if constexpr (std::is_arithmetic<RP(T)>::value) {                                                       // arithmetic types
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {                                 // register binary writer
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {                            // register binary writer
                 file.write(reinterpret_cast<const char *>(obj), sizeof(T));
                 return sizeof(T);
-            };
-            type_writer_xml[typenm] = [] (const void *obj, std::string name, tinyxml2::XMLElement *root) {      // register xml writer
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
-                elem->SetAttribute("val", std::to_string(*reinterpret_cast<const T *>(obj)).c_str());
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int { // register xml writer
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
+                elem->SetAttribute("val", static_cast<my_type_traits::xml_arith_t<RP(T)>>(*reinterpret_cast<const T *>(obj)));
                 root->InsertEndChild(elem);
                 return 1;
-            };
+            });
         } else if constexpr (my_type_traits::is_unique_ptr<RP(T)>::value) {                                     // unique_ptr
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
                 const T *ptr = reinterpret_cast<const T *>(obj);
-                return type_writer_bin[demangle_ind(typeid(typename T::element_type).name())](&**ptr, file);
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {       
+                return dispatch<RP(typename T::element_type)>::writer_bin()(&**ptr, file);
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {       
                 const T *ptr = reinterpret_cast<const T *>(obj);
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
                 elem->SetAttribute("type", "unique_ptr");
                 root->InsertEndChild(elem);
-                return type_writer_xml[demangle_ind(typeid(typename T::element_type).name())](&**ptr, "object", elem);
-            };
-        } else if constexpr (std::is_pointer<RP(T)>::value) {                                                   // pointer types
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
-                const T ptr = *reinterpret_cast<const T *>(obj);
-                return type_writer_bin[demangle(*ptr)](ptr, file);
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {
-                const T ptr = *reinterpret_cast<const T *>(obj);
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
-                elem->SetAttribute("type", "pointer");
+                return dispatch<RP(typename T::element_type)>::writer_xml()(&**ptr, "object", elem);
+            });
+        } else if constexpr (std::is_pointer<RP(T)>::value || my_type_traits::is_shared_ptr<RP(T)>::value) {     // raw and shared pointers keep their identity
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
+                identity_scope identity;
+                const T &ptr = *reinterpret_cast<const T *>(obj);
+                unsigned int size = sizeof(unsigned int), ref = 0;
+                bool fresh = track_written(ptr, ref);
+                file.write(reinterpret_cast<const char *>(&ref), sizeof(unsigned int));
+                if (!fresh) return size;
+                if constexpr (std::is_polymorphic<target_of<T>>::value) {
+                    return size + type_writer_bin.at(demangle(*ptr))(raw_pointer(ptr), file);              // the dynamic type decides
+                } else {
+                    return size + dispatch<target_of<T>>::writer_bin()(raw_pointer(ptr), file);
+                }
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {
+                identity_scope identity;
+                const T &ptr = *reinterpret_cast<const T *>(obj);
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
+                elem->SetAttribute("type", std::is_pointer<RP(T)>::value ? "pointer" : "shared_ptr");
                 root->InsertEndChild(elem);
-                return type_writer_xml[demangle(*ptr)](ptr, "object", elem);
-            };
+                unsigned int ref = 0;
+                if (!track_written(ptr, ref)) {
+                    if (ref != 0) elem->SetAttribute("ref", ref);
+                    return 1;
+                }
+                elem->SetAttribute("id", ref);
+                if constexpr (std::is_polymorphic<target_of<T>>::value) {
+                    return type_writer_xml.at(demangle(*ptr))(raw_pointer(ptr), "object", elem);
+                } else {
+                    return dispatch<target_of<T>>::writer_xml()(raw_pointer(ptr), "object", elem);
+                }
+            });
         } else if constexpr (std::is_array<RP(T)>::value) {                                                     // array types
             int extent = std::extent<RP(T)>::value;
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
                 const typename std::remove_extent<T>::type *arr = reinterpret_cast<const typename std::remove_extent<T>::type *>(obj);
+                if (is_plain<RP(T)>()) {
+                    return write_block(reinterpret_cast<const RP(T) *>(obj), 1, file);
+                }
+                writer_bin_fn write = dispatch<RP(typename std::remove_extent<T>::type)>::writer_bin();
                 for (size_t i = 0; i < std::extent<RP(T)>::value; i++) {
-                    if (type_writer_bin.find(demangle(arr[i])) == type_writer_bin.end()) {
-                        std::cerr << "No writer for " << demangle(arr[i]) << std::endl;
-                    }
-                    type_writer_bin[demangle(arr[i])](&arr[i], file);
+                    write(&arr[i], file);
                 }
                 return sizeof(T);
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {       
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {       
                 const typename std::remove_extent<T>::type *arr = reinterpret_cast<const typename std::remove_extent<T>::type *>(obj);
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
                 root->InsertEndChild(elem);
                 unsigned int size = 1;
+                writer_xml_fn write = dispatch<RP(typename std::remove_extent<T>::type)>::writer_xml();
                 for (size_t i = 0; i < std::extent<RP(T)>::value; i++) {
-                    size += type_writer_xml[demangle(arr[i])](&arr[i], "element", elem);
+                    size += write(&arr[i], "element", elem);
                 }
                 return size;
-            };
-        } else if constexpr (std::is_same<RP(T), std::string>::value) {                                         // string types
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
+            });
+        } else if constexpr (my_type_traits::is_string<RP(T)>::value) {                                         // string types
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
                 const T *str = reinterpret_cast<const T *>(obj);
+                if (string_dictionary) {
+                    return write_dictionary_string(*str, file);
+                }
                 unsigned int size = str->size();
                 file.write(reinterpret_cast<const char *>(&size), sizeof(unsigned int));
                 file.write(str->c_str(), str->size());
                 return str->size() + sizeof(unsigned int);
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {
                 const T *str = reinterpret_cast<const T *>(obj);
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
                 tinyxml2::XMLText *text = root->GetDocument()->NewText(str->c_str());
                 elem->InsertEndChild(text);
                 root->InsertEndChild(elem);
                 return 1;
-            };
+            });
         } else if constexpr (my_type_traits::is_pair<RP(T)>::value) {                                           // pair types
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
                 const T *pair = reinterpret_cast<const T *>(obj);
-                type_writer_bin[demangle(pair->first)](&pair->first, file);
-                type_writer_bin[demangle(pair->second)](&pair->second, file);
-                return sizeof(T);
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {
+                unsigned int size = dispatch<RP(decltype(pair->first))>::writer_bin()(&pair->first, file);
+                return size + dispatch<RP(decltype(pair->second))>::writer_bin()(&pair->second, file);
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {
                 const T *pair = reinterpret_cast<const T *>(obj);
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
                 root->InsertEndChild(elem);
                 unsigned int size = 1;
-                size += type_writer_xml[demangle(pair->first)](&pair->first, "first", elem);
-                size += type_writer_xml[demangle(pair->second)](&pair->second, "second", elem);
+                size += dispatch<RP(decltype(pair->first))>::writer_xml()(&pair->first, "first", elem);
+                size += dispatch<RP(decltype(pair->second))>::writer_xml()(&pair->second, "second", elem);
                 return size;
-            };
+            });
         } else if constexpr (my_type_traits::is_container<RP(T)>::value && !my_type_traits::is_map<RP(T)>::value) { // container types (not map)
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
                 const T *cont = reinterpret_cast<const T *>(obj);
-                unsigned int size = 1, cnt = cont->size();
+                unsigned int size = (unsigned int)sizeof(unsigned int), cnt = cont->size();
                 file.write(reinterpret_cast<const char *>(&cnt), sizeof(unsigned int));
+                if constexpr (packable<RP(T)>()) {
+                    if (packed_keys) {
+                        return size + write_packed(*cont, file);
+                    }
+                }
+                if constexpr (my_type_traits::is_contiguous_container<RP(T)>::value) {
+                    if (is_plain<RP(typename T::value_type)>()) {
+                        return size + write_block(cont->data(), cnt, file);
+                    }
+                }
+                writer_bin_fn write = dispatch<RP(typename T::value_type)>::writer_bin();
                 for (auto it = cont->begin(); it != cont->end(); it++) {
-                    size += type_writer_bin[demangle(*it)]((void *)(&(*it)), file);
+                    size += write((void *)(&(*it)), file);
                 }
                 return size;
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {
                 const T *cont = reinterpret_cast<const T *>(obj);
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
                 root->InsertEndChild(elem);
                 unsigned int size = 1;
+                writer_xml_fn write = dispatch<RP(typename T::value_type)>::writer_xml();
                 for (auto it = cont->begin(); it != cont->end(); it++) {
-                    size += type_writer_xml[demangle(*it)]((void *)(&(*it)), "element", elem);
+                    size += write((void *)(&(*it)), "element", elem);
                 }
                 return size;
-            };
+            });
         } else if constexpr (my_type_traits::is_map<RP(T)>::value) {                                                // map types
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
                 const T *cont = reinterpret_cast<const T *>(obj);
                 unsigned int size = (unsigned int)sizeof(unsigned int), cnt = cont->size();
                 file.write(reinterpret_cast<const char *>(&cnt), sizeof(unsigned int));
+                writer_bin_fn write_key = dispatch<RP(typename T::key_type)>::writer_bin();         // the entries are written as pairs are,
+                writer_bin_fn write_value = dispatch<RP(typename T::mapped_type)>::writer_bin();    // without copying them into one
+                if constexpr (packable<RP(T)>()) {
+                    if (packed_keys) {
+                        return size + write_packed(*cont, file, [&](const auto &value) { return write_value(&value, file); });
+                    }
+                }
                 for (auto it = cont->begin(); it != cont->end(); it++) {
-                    std::pair<typename T::key_type, typename T::mapped_type> pair = *it;
-                    size += type_writer_bin[demangle(pair)]((void *)(&pair), file);
+                    size += write_key(&it->first, file);
+                    size += write_value(&it->second, file);
                 }
                 return size;
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {
                 const T *cont = reinterpret_cast<const T *>(obj);
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
                 root->InsertEndChild(elem);
                 unsigned int size = 1;
+                writer_xml_fn write_key = dispatch<RP(typename T::key_type)>::writer_xml();
+                writer_xml_fn write_value = dispatch<RP(typename T::mapped_type)>::writer_xml();
                 for (auto it = cont->begin(); it != cont->end(); it++) {
-                    std::pair<typename T::key_type, typename T::mapped_type> pair = *it;
-                    size += type_writer_xml[demangle(pair)]((void *)(&pair), "element_pair", elem);
+                    tinyxml2::XMLElement *pair = root->GetDocument()->NewElement("element_pair");
+                    elem->InsertEndChild(pair);
+                    size += 1;
+                    size += write_key(&it->first, "first", pair);
+                    size += write_value(&it->second, "second", pair);
                 }
                 return size;
-            };
+            });
         } else if constexpr (std::is_class<RP(T)>::value) {                                                         // user defined class types
-            type_writer_bin[typenm] = [](const void *obj, std::ostream &file) {
+            type_writer_bin.insert(typenm, [](const void *obj, std::ostream &file) -> unsigned int {
                 unsigned int size = 0;
-                typeInfo &info = typeInfo_map[demangle_ind(typeid(RP(T)).name())];
+                const typeInfo &info = dispatch<RP(T)>::info();
+                if (info.plain) {
+                    return write_block(reinterpret_cast<const RP(T) *>(obj), 1, file);
+                }
                 for (auto i = info.members.begin(); i != info.members.end(); i++) {
                     const char *dat = reinterpret_cast<const char *>(obj) + i->offset;
-                    size += type_writer_bin[i->typenm]((void *)dat, file);
+                    size += i->writer_bin((void *)dat, file);
                 }
                 return size;
-            };
-            type_writer_xml[typenm] = [](const void *obj, std::string name, tinyxml2::XMLElement *root) {
-                typeInfo &info = typeInfo_map[demangle_ind(typeid(RP(T)).name())];
-                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
-                elem->SetAttribute("type", GetName(*reinterpret_cast<const T*>(obj)));
+            });
+            type_writer_xml.insert(typenm, [](const void *obj, const char *name, tinyxml2::XMLElement *root) -> unsigned int {
+                const typeInfo &info = dispatch<RP(T)>::info();
+                tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
+                elem->SetAttribute("type", dispatch<RP(T)>::name());
                 root->InsertEndChild(elem);
                 unsigned int size = 1;
                 for (auto i = info.members.begin(); i != info.members.end(); i++) {
                     const char *dat = reinterpret_cast<const char *>(obj) + i->offset;
-                    size += type_writer_xml[i->typenm]((void *)dat, i->name, elem);
+                    size += i->writer_xml((void *)dat, i->name.c_str(), elem);
                 }
                 return size;
-            };
+            });
         } else {
             throw std::runtime_error("Unsupported type");
         }
@@ -260,265 +1163,317 @@ namespace type_info {
     template <typename T>
     void RegisterReader_(const T &x) {
         std::string typenm = type_info::demangle_ind(typeid(RP(T)).name());
-        if (type_reader_bin.find(typenm) != type_reader_bin.end()) {
+        if (type_reader_bin.contains(typenm)) {
             return;
         }
+        type_skipper_bin.insert(typenm, [](std::istream &file) -> size_t {                                     // register binary skipper
+            return bin_srl::skip_bin<RP(T)>(file);
+        });
         if constexpr (std::is_arithmetic<RP(T)>::value) {
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 file.read(reinterpret_cast<char *>(obj), sizeof(T));
                 return sizeof(T);
-            };
-            if constexpr (std::is_floating_point<RP(T)>::value) {
-                type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
-                    tinyxml2::XMLElement *elem = root;
-                    if (!itself) elem = elem->FirstChildElement(name.c_str());
-                    T *dat = reinterpret_cast<T *>(obj);
-                    *dat = std::stod(elem->Attribute("val"));
-                    return 1;
-                };
-            } else {
-                type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
-                    tinyxml2::XMLElement *elem = root;
-                    if (!itself) elem = elem->FirstChildElement(name.c_str());
-                    T *dat = reinterpret_cast<T *>(obj);
-                    *dat = std::stoi(elem->Attribute("val"));
-                    return 1;
-                };
-            }
+            });
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
+                tinyxml2::XMLElement *elem = root;
+                if (!itself) elem = elem->FirstChildElement(name);
+                my_type_traits::xml_arith_t<RP(T)> val{};
+                if (elem->QueryAttribute("val", &val) != tinyxml2::XML_SUCCESS) {
+                    std::cerr << "invalid value of " << name << std::endl;
+                    throw std::runtime_error("invalid value");
+                }
+                *reinterpret_cast<T *>(obj) = static_cast<T>(val);
+                return 1;
+            });
         } else if constexpr (my_type_traits::is_unique_ptr<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 T *ptr = reinterpret_cast<T *>(obj);
                 *ptr = std::unique_ptr<typename T::element_type>(new typename T::element_type());
-                return type_reader_bin[demangle_ind(typeid(typename T::element_type).name())](&**ptr, file);
-            };
+                return dispatch<RP(typename T::element_type)>::reader_bin()(&**ptr, file);
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 T *ptr = reinterpret_cast<T *>(obj);
                 *ptr = std::unique_ptr<typename T::element_type>(new typename T::element_type());
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
-                return type_reader_xml[demangle_ind(typeid(typename T::element_type).name())](&**ptr, "object", elem, 0);
-            };
-        } else if constexpr (std::is_pointer<RP(T)>::value) {
+                if (!itself) elem = elem->FirstChildElement(name);
+                return dispatch<RP(typename T::element_type)>::reader_xml()(&**ptr, "object", elem, 0);
+            });
+        } else if constexpr (std::is_pointer<RP(T)>::value || my_type_traits::is_shared_ptr<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
-                obj = new typename std::remove_pointer<T>::type();
-                return type_reader_bin[demangle_ind(typeid(std::remove_pointer<T>::type).name())](obj, file);
-            };
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
+                identity_scope identity;
+                T &ptr = *reinterpret_cast<T *>(obj);
+                unsigned int size = sizeof(unsigned int), ref = 0;
+                file.read(reinterpret_cast<char *>(&ref), sizeof(unsigned int));
+                if (ref == 0) {
+                    ptr = nullptr;
+                } else if (ref == next_read_id<T>()) {
+                    auto target = track_new<T>();
+                    ptr = target;
+                    size += dispatch<target_of<T>>::reader_bin()(raw_pointer(target), file);
+                } else {
+                    ptr = tracked<T>(ref);
+                }
+                return size;
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
-                obj = new typename std::remove_pointer<T>::type();
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
+                identity_scope identity;
+                T &ptr = *reinterpret_cast<T *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
-                return type_reader_xml[demangle_ind(typeid(std::remove_pointer<T>::type).name())](obj, "object", elem, 0);
-            };
+                if (!itself) elem = elem->FirstChildElement(name);
+                unsigned int ref = 0;
+                if (elem->QueryUnsignedAttribute("ref", &ref) == tinyxml2::XML_SUCCESS) {
+                    ptr = tracked<T>(ref);
+                    return 1;
+                }
+                if (elem->FirstChildElement("object") == nullptr) {
+                    ptr = nullptr;
+                    return 1;
+                }
+                skip_to_id<T>(elem->UnsignedAttribute("id"));
+                auto target = track_new<T>();
+                ptr = target;
+                return dispatch<target_of<T>>::reader_xml()(raw_pointer(target), "object", elem, 0);
+            });
         } else if constexpr (std::is_array<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 typename std::remove_extent<T>::type *arr = reinterpret_cast<typename std::remove_extent<T>::type *>(obj);
+                if (is_plain<RP(T)>()) {
+                    file.read(reinterpret_cast<char *>(obj), sizeof(T));
+                    return sizeof(T);
+                }
+                reader_bin_fn read = dispatch<RP(typename std::remove_extent<T>::type)>::reader_bin();
                 for (size_t i = 0; i < std::extent<RP(T)>::value; i++) {
-                    if (type_reader_bin.find(demangle(arr[i])) == type_reader_bin.end()) {
-                        std::cerr << "No reader for " << demangle(arr[i]) << std::endl;
-                    }
-                    type_reader_bin[demangle(arr[i])](&arr[i], file);
+                    read(&arr[i], file);
                 }
                 return sizeof(T);
-            };
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 typename std::remove_extent<T>::type *arr = reinterpret_cast<typename std::remove_extent<T>::type *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
                 unsigned int size = 1;
+                reader_xml_fn read = dispatch<RP(typename std::remove_extent<T>::type)>::reader_xml();
                 for (size_t i = 0; i < std::extent<RP(T)>::value, elit != nullptr; i++) {
-                    size += type_reader_xml[demangle(arr[i])](&arr[i], "element", elit, 1);
+                    size += read(&arr[i], "element", elit, 1);
                     elit = elit->NextSiblingElement();
                 }
                 return size;
-            };
-        } else if constexpr (std::is_same<RP(T), std::string>::value) {
+            });
+        } else if constexpr (my_type_traits::is_string<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 T *str = reinterpret_cast<T *>(obj);
+                if (string_dictionary) {
+                    return read_dictionary_string(*str, file);
+                }
                 unsigned int size = str->size();
                 str->clear();
                 file.read(reinterpret_cast<char *>(&size), sizeof(unsigned int));
-                for (int i = 0; i < (int)size; ++ i) {
-                    char c;
-                    file.read(&c, 1);
-                    str->push_back(c);
-                }
+                str->resize(size);
+                file.read(&(*str)[0], size);
                 return size + sizeof(unsigned int);
-            };
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 T *str = reinterpret_cast<T *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 *str = elem->GetText();
                 return 1;
-            };
+            });
         } else if constexpr (my_type_traits::is_pair<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 T *pair = reinterpret_cast<T *>(obj);
-                type_reader_bin[demangle(pair->first)](&pair->first, file);
-                type_reader_bin[demangle(pair->second)](&pair->second, file);
-                return sizeof(T);
-            };
+                unsigned int size = dispatch<RP(decltype(pair->first))>::reader_bin()(&pair->first, file);
+                return size + dispatch<RP(decltype(pair->second))>::reader_bin()(&pair->second, file);
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 T *pair = reinterpret_cast<T *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 unsigned int size = 1;
-                size += type_reader_xml[demangle(pair->first)](&pair->first, "first", elem, 0);
-                size += type_reader_xml[demangle(pair->second)](&pair->second, "second", elem, 0);
+                size += dispatch<RP(decltype(pair->first))>::reader_xml()(&pair->first, "first", elem, 0);
+                size += dispatch<RP(decltype(pair->second))>::reader_xml()(&pair->second, "second", elem, 0);
                 return size;
-            };
+            });
         } else if constexpr (my_type_traits::is_sequence_container<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 unsigned int size = 1, cnt = 0;
                 file.read(reinterpret_cast<char *>(&cnt), sizeof(unsigned int));
                 size = sizeof(unsigned int);
+                if constexpr (my_type_traits::is_contiguous_container<RP(T)>::value) {
+                    if (is_plain<RP(typename T::value_type)>()) {
+                        return size + read_block(*cont, cnt, file);
+                    }
+                }
+                reader_bin_fn read = dispatch<RP(typename T::value_type)>::reader_bin();
                 for (int i = 0; i < (int)cnt; ++ i) {
-                    typename std::remove_cv<typename T::value_type>::type elem;
-                    size += type_reader_bin[demangle(elem)]((void *)(&elem), file);
-                    cont->push_back(elem);
+                    auto elem = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read((void *)(&elem), file);
+                    cont->push_back(std::move(elem));
                 }
                 return size;
-            };
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 int size = 1;
                 tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
+                reader_xml_fn read = dispatch<RP(typename T::value_type)>::reader_xml();
                 while(elit) {
-                    typename std::remove_cv<typename T::value_type>::type it;
-                    size += type_reader_xml[demangle(it)](&it, "element", elit, 1);
-                    cont->push_back(it);
+                    auto it = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read(&it, "element", elit, 1);
+                    cont->push_back(std::move(it));
                     elit = elit->NextSiblingElement();
                 }
                 return size;
-            };
+            });
         } else if constexpr (my_type_traits::is_container_adaptor<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 unsigned int size = 0, cnt = 0;
                 file.read(reinterpret_cast<char *>(&cnt), sizeof(unsigned int));
                 size = sizeof(unsigned int);
+                reader_bin_fn read = dispatch<RP(typename T::value_type)>::reader_bin();
                 for (int i = 0; i < (int)cnt; ++ i) {
-                    typename std::remove_cv<typename T::value_type>::type elem;
-                    size += type_reader_bin[demangle(elem)]((void *)(&elem), file);
-                    cont->push(elem);
+                    auto elem = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read((void *)(&elem), file);
+                    cont->push(std::move(elem));
                 }
                 return size;
-            };
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 int size = 1;
                 tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
+                reader_xml_fn read = dispatch<RP(typename T::value_type)>::reader_xml();
                 while(elit) {
-                    typename std::remove_cv<typename T::value_type>::type it;
-                    size += type_reader_xml[demangle(it)](&it, "element", elit, 1);
-                    cont->push(it);
+                    auto it = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read(&it, "element", elit, 1);
+                    cont->push(std::move(it));
                     elit = elit->NextSiblingElement();
                 }
                 return size;
-            };
+            });
         } else if constexpr (my_type_traits::is_set<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 unsigned int size = 0, cnt = 0;
                 file.read(reinterpret_cast<char *>(&cnt), sizeof(unsigned int));
                 size = sizeof(unsigned int);
+                if constexpr (packable<RP(T)>()) {
+                    if (packed_keys) {
+                        return size + read_packed(*cont, cnt, file);
+                    }
+                }
+                reader_bin_fn read = dispatch<RP(typename T::value_type)>::reader_bin();
                 for (int i = 0; i < (int)cnt; ++ i) {
-                    typename std::remove_cv<typename T::value_type>::type elem;
-                    size += type_reader_bin[demangle(elem)]((void *)(&elem), file);
-                    cont->insert(elem);
+                    auto elem = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read((void *)(&elem), file);
+                    cont->insert(std::move(elem));
                 }
                 return size;
-            };
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 int size = 1;
                 tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
+                reader_xml_fn read = dispatch<RP(typename T::value_type)>::reader_xml();
                 while(elit) {
-                    typename std::remove_cv<typename T::value_type>::type it;
-                    size += type_reader_xml[demangle(it)](&it, "element", elit, 1);
-                    cont->insert(it);
+                    auto it = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read(&it, "element", elit, 1);
+                    cont->insert(std::move(it));
                     elit = elit->NextSiblingElement();
                 }
                 return size;
-            };
+            });
         } else if constexpr (my_type_traits::is_map<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 unsigned int size = 0, cnt = 0;
                 file.read(reinterpret_cast<char *>(&cnt), sizeof(unsigned int));
                 size = sizeof(unsigned int);
+                if constexpr (packable<RP(T)>()) {
+                    if (packed_keys) {
+                        reader_bin_fn read_value = dispatch<RP(typename T::mapped_type)>::reader_bin();
+                        return size + read_packed(*cont, cnt, file, [&](auto &value) { return read_value(&value, file); });
+                    }
+                }
+                reader_bin_fn read = dispatch<std::pair<typename std::remove_cv<typename T::key_type>::type,
+                    typename std::remove_cv<typename T::mapped_type>::type>>::reader_bin();
                 for (int i = 0; i < (int)cnt; ++ i) {
-                    std::pair<typename std::remove_cv<typename T::key_type>::type,
-                        typename std::remove_cv<typename T::mapped_type>::type> elem;
-                    size += type_reader_bin[demangle(elem)]((void *)(&elem), file);
-                    cont->insert(elem);
+                    auto elem = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read((void *)(&elem), file);
+                    cont->insert(std::move(elem));
                 }
                 return size;
-            };
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 T *cont = reinterpret_cast<T *>(obj);
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 int size = 1;
                 tinyxml2::XMLElement *elit = elem->FirstChildElement("element_pair");
+                reader_xml_fn read = dispatch<std::pair<typename std::remove_cv<typename T::key_type>::type,
+                    typename std::remove_cv<typename T::mapped_type>::type>>::reader_xml();
                 while(elit) {
-                    std::pair<typename std::remove_cv<typename T::key_type>::type,
-                        typename std::remove_cv<typename T::mapped_type>::type> it;
-                    size += type_reader_xml[demangle(it)](&it, "element_pair", elit, 1);
-                    cont->insert(it);
+                    auto it = make_element<my_type_traits::mutable_value_t<typename T::value_type>>(allocator_of(*cont));
+                    size += read(&it, "element_pair", elit, 1);
+                    cont->insert(std::move(it));
                     elit = elit->NextSiblingElement();
                 }
                 return size;
-            };
+            });
         } else if constexpr (std::is_class<RP(T)>::value) {
             // bin
-            type_reader_bin[typenm] = [](void *obj, std::istream &file) {
+            type_reader_bin.insert(typenm, [](void *obj, std::istream &file) -> unsigned int {
                 unsigned int size = 0;
-                typeInfo &info = typeInfo_map[demangle_ind(typeid(RP(T)).name())];
+                const typeInfo &info = dispatch<RP(T)>::info();
+                if (info.plain) {
+                    file.read(reinterpret_cast<char *>(obj), sizeof(T));
+                    return sizeof(T);
+                }
                 for (auto i = info.members.begin(); i != info.members.end(); i++) {
                     char *dat = reinterpret_cast<char *>(obj) + i->offset;
-                    size += type_reader_bin[i->typenm]((void *)dat, file);
+                    size += i->reader_bin((void *)dat, file);
                 }
                 return size;
-            };
+            });
             // xml
-            type_reader_xml[typenm] = [](void *obj, std::string name, tinyxml2::XMLElement *root, int itself) {
+            type_reader_xml.insert(typenm, [](void *obj, const char *name, tinyxml2::XMLElement *root, int itself) -> unsigned int {
                 tinyxml2::XMLElement *elem = root;
-                if (!itself) elem = elem->FirstChildElement(name.c_str());
+                if (!itself) elem = elem->FirstChildElement(name);
                 unsigned int size = 1;
-                typeInfo &info = typeInfo_map[demangle_ind(typeid(RP(T)).name())];
+                const typeInfo &info = dispatch<RP(T)>::info();
                 for (auto i = info.members.begin(); i != info.members.end(); i++) {
                     char *dat = reinterpret_cast<char *>(obj) + i->offset;
-                    size += type_reader_xml[i->typenm]((void *)dat, i->name, elem, 0);
+                    size += i->reader_xml((void *)dat, i->name.c_str(), elem, 0);
                 }
                 return size;
-            };
+            });
         } else {
             throw std::runtime_error("Unsupported type");
         }
@@ -529,23 +1484,23 @@ namespace type_info {
     void RegisterBaseType_(const T &x) {
         RegisterWriter_(x);     // register writer
         RegisterReader_(x);     // register reader
-        if (type_name_map.find(demangle(x)) == type_name_map.end()) {   // register type name
-            type_name_map[demangle(x)] = demangle(x);
-        }
+        type_name_map.insert(demangle(x), demangle(x));    // register type name, a registered struct name is kept
     }
 
     // register a type recursively
     template <typename T>
     void RegisterType_(const T &t) {
         std::string typenm = demangle(t);
-        if (type_writer_bin.find(typenm) != type_writer_bin.end()) return;
+        if (type_writer_bin.contains(typenm)) return;
         if constexpr (std::is_arithmetic<RP(T)>::value ||
-                      std::is_same<RP(T), std::string>::value) {
+                      my_type_traits::is_string<RP(T)>::value) {
             RegisterBaseType_(t);
         } else {
-            if constexpr (std::is_pointer<RP(T)>::value) {
-                typename std::remove_pointer<RP(T)>::type tmp;
-                RegisterType_(tmp);
+            if constexpr (std::is_pointer<RP(T)>::value || my_type_traits::is_shared_ptr<RP(T)>::value) {
+                if constexpr (!my_type_traits::is_struct<target_of<RP(T)>>::value) {    // a struct may point to its own type,
+                    target_of<RP(T)> tmp;                                               // which is looked up when first written
+                    RegisterType_(tmp);
+                }
                 RegisterBaseType_(t);
             } else if constexpr (my_type_traits::is_unique_ptr<RP(T)>::value) {
                 typename T::element_type tmp;
@@ -577,29 +1532,47 @@ namespace type_info {
 
     // register a member type
     template <typename T>
-    memberPair::memberPair(std::string name, const T& t): name(name), offset((size_t)&t) {
+    memberPair::memberPair(std::string name, const T& t): name(name), offset((size_t)&t), size(sizeof(T)) {
         RegisterType_(t);
         this->typenm = demangle(t);
+        plain = is_plain<RP(T)>();
+        writer_bin = dispatch<RP(T)>::writer_bin();
+        reader_bin = dispatch<RP(T)>::reader_bin();
+        writer_xml = dispatch<RP(T)>::writer_xml();
+        reader_xml = dispatch<RP(T)>::reader_xml();
+        sizer_bin = dispatch<RP(T)>::sizer_bin();
+        skipper_bin = dispatch<RP(T)>::skipper_bin();
     }
 
     // the common ctor of memberPair
-    memberPair::memberPair(std::string name, std::string typenm, size_t size): name(name), typenm(typenm), offset(size) {}
+    inline memberPair::memberPair(std::string name, std::string typenm, size_t size): name(name), typenm(typenm), offset(size) {
+        writer_bin = type_writer_bin.at(typenm);
+        reader_bin = type_reader_bin.at(typenm);
+        writer_xml = type_writer_xml.at(typenm);
+        reader_xml = type_reader_xml.at(typenm);
+        sizer_bin = type_sizer_bin.at(typenm);
+        skipper_bin = type_skipper_bin.at(typenm);
+    }
 
     // the register function of a struct. This is the function for user to call
     template <typename T>
     void RegisterStruct(std::string name, const T &x, std::initializer_list<memberPair> members) {
-        if (typeInfo_map.find(name) != typeInfo_map.end()) return;
+        if (typeInfo_map.contains(demangle(x))) return;
         typeInfo newType;   // register new struct type
         newType.name = name;
         newType.typenm = demangle(x);
         newType.members.clear();
+        size_t end = 0;
+        newType.plain = std::is_trivially_copyable<T>::value;
         for (auto& member: members) {  // get all the members
-            newType.members.push_back(memberPair(member.name, member.typenm, member.offset - (size_t)&x));
-        }
-        typeInfo_map[newType.typenm] = newType;
-        if (type_name_map.find(demangle(x)) == type_name_map.end()) {
-            type_name_map[demangle(x)] = name;
+            newType.members.push_back(member);
+            newType.members.back().offset -= (size_t)&x;
+            if (!member.plain || newType.members.back().offset != end) newType.plain = false;   // a gap, a reorder or a member with its own encoding
+            end = newType.members.back().offset + member.size;
         }
+        if (end != sizeof(T)) newType.plain = false;                                        // padding at the end
+        typeInfo_map.insert(newType.typenm, newType);
+        type_name_map.insert(demangle(x), name);
         RegisterBaseType_(x);  // register writer and reader
     }
 }
\ No newline at end of file
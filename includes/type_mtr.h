@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <cstdlib>
+#include <cstdint>
 #include <cxxabi.h>
 #include <type_traits>
 #include <memory>
@@ -29,6 +30,14 @@ namespace my_type_traits {
     template <typename T>
     inline constexpr bool is_pair_v = is_pair<T>::value;
 
+    // judge if it's a string, whatever its allocator
+    template <typename T>
+    struct is_string : std::false_type {};
+    template <typename Traits, typename Alloc>
+    struct is_string<std::basic_string<char, Traits, Alloc>> : std::true_type {};
+    template <typename T>
+    inline constexpr bool is_string_v = is_string<T>::value;
+
     // judge if it's a container
     template <typename T, typename ... X>                       // the method is the same as matching pair
     struct is_container : std::false_type {};
@@ -81,6 +90,24 @@ namespace my_type_traits {
     template <typename T, typename ... X>
     inline constexpr bool is_sequence_container_v = is_sequence_container<T, X ...>::value;
 
+    // judge if it's a sequence container with random access
+    template <typename T, typename ... X>
+    struct is_random_access_container : std::false_type {};
+    template <typename T, typename ... X>
+    struct is_random_access_container<std::vector<T, X ...>> : std::true_type {};
+    template <typename T, typename ... X>
+    struct is_random_access_container<std::deque<T, X ...>> : std::true_type {};
+    template <typename T, typename ... X>
+    inline constexpr bool is_random_access_container_v = is_random_access_container<T, X ...>::value;
+
+    // judge if it's a container that keeps its elements in one block, vector<bool> does not
+    template <typename T, typename ... X>
+    struct is_contiguous_container : std::false_type {};
+    template <typename T, typename ... X>
+    struct is_contiguous_container<std::vector<T, X ...>> : std::bool_constant<!std::is_same<T, bool>::value> {};
+    template <typename T, typename ... X>
+    inline constexpr bool is_contiguous_container_v = is_contiguous_container<T, X ...>::value;
+
     // judge if it's a set
     template <typename T, typename ... X>
     struct is_set : std::false_type {};
@@ -105,6 +132,20 @@ namespace my_type_traits {
     template <typename T, typename ... X>
     inline constexpr bool is_map_v = is_map<T, X ...>::value;
 
+    // judge if it's a set or a map that keeps its keys sorted
+    template <typename T, typename ... X>
+    struct is_ordered : std::false_type {};
+    template <typename T, typename ... X>
+    struct is_ordered<std::set<T, X ...>> : std::true_type {};
+    template <typename T, typename ... X>
+    struct is_ordered<std::multiset<T, X ...>> : std::true_type {};
+    template <typename T, typename U, typename ... X>
+    struct is_ordered<std::map<T, U, X ...>> : std::true_type {};
+    template <typename T, typename U, typename ... X>
+    struct is_ordered<std::multimap<T, U, X ...>> : std::true_type {};
+    template <typename T, typename ... X>
+    inline constexpr bool is_ordered_v = is_ordered<T, X ...>::value;
+
     // judge if it's a unique_ptr
     template <typename T, typename ... X>
     struct is_unique_ptr : std::false_type {};
@@ -112,4 +153,41 @@ namespace my_type_traits {
     struct is_unique_ptr<std::unique_ptr<T, X ...>> : std::true_type {};
     template <typename T, typename ... X>
     inline constexpr bool is_unique_ptr_v = is_unique_ptr<T, X ...>::value;
+
+    // judge if it's a shared_ptr
+    template <typename T>
+    struct is_shared_ptr : std::false_type {};
+    template <typename T>
+    struct is_shared_ptr<std::shared_ptr<T>> : std::true_type {};
+    template <typename T>
+    inline constexpr bool is_shared_ptr_v = is_shared_ptr<T>::value;
+
+    // judge if it's a user defined class, which is registered as a struct
+    template <typename T>
+    struct is_struct : std::bool_constant<std::is_class<T>::value && !is_string<T>::value && !is_pair<T>::value &&
+                                          !is_container<T>::value && !is_container_adaptor<T>::value &&
+                                          !is_unique_ptr<T>::value && !is_shared_ptr<T>::value> {};
+    template <typename T>
+    inline constexpr bool is_struct_v = is_struct<T>::value;
+
+    // the type an element of a container is decoded into, map keys lose their const
+    template <typename T>
+    struct mutable_value { using type = typename std::remove_cv<T>::type; };
+    template <typename K, typename V>
+    struct mutable_value<std::pair<const K, V>> { using type = std::pair<K, V>; };
+    template <typename T>
+    using mutable_value_t = typename mutable_value<T>::type;
+
+    // the type tinyxml2 reads and writes an arithmetic type as
+    template <typename T>
+    struct xml_arith {
+        using type = std::conditional_t<std::is_same<T, bool>::value, bool,
+                     std::conditional_t<std::is_same<T, float>::value, float,
+                     std::conditional_t<std::is_floating_point<T>::value, double,
+                     std::conditional_t<std::is_signed<T>::value,
+                        std::conditional_t<(sizeof(T) <= sizeof(int)), int, int64_t>,
+                        std::conditional_t<(sizeof(T) <= sizeof(unsigned)), unsigned, uint64_t>>>>>;
+    };
+    template <typename T>
+    using xml_arith_t = typename xml_arith<T>::type;
 }
\ No newline at end of file
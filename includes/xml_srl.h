@@ -10,6 +10,13 @@
 #include <memory>
 #include <cxxabi.h>
 #include <type_traits>
+#include <vector>
+#include <atomic>
+#include <memory_resource>
+#include <algorithm>
+#include <iterator>
+#include "parallel.h"
+#include "block_stream.h"
 #include "tinyxml2.h"
 #include "type_mtr.h"
 #include "type_info.h"
@@ -32,53 +39,60 @@ namespace xml_srl {
      * @return the output size of xml data
      */
     template<class T>
-    unsigned int write_xml(const T& obj, std::string name, tinyxml2::XMLElement *root) {
+    unsigned int write_xml(const T& obj, const char *name, tinyxml2::XMLElement *root) {
+        type_info::identity_scope identity(!std::is_arithmetic<RR(T)>::value);
         if constexpr (std::is_arithmetic<RR(T)>::value) {                                                       // arithmetic type
-            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
-            elem->SetAttribute("val", std::to_string(obj).c_str());
+            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
+            elem->SetAttribute("val", static_cast<my_type_traits::xml_arith_t<RR(T)>>(obj));
             root->InsertEndChild(elem);
             return 1;
-        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_unique_ptr<RR(T)>::value) {    // pointer type
-            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
-            elem->SetAttribute("type", std::is_pointer<RR(T)>::value ? "pointer" : "unique_ptr");
+        } else if constexpr (my_type_traits::is_unique_ptr<RR(T)>::value) {                                      // unique_ptr type
+            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
+            elem->SetAttribute("type", "unique_ptr");
             root->InsertEndChild(elem);
             return write_xml(*obj, "object", elem);
+        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_shared_ptr<RR(T)>::value) {     // pointer type, written once
+            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
+            elem->SetAttribute("type", std::is_pointer<RR(T)>::value ? "pointer" : "shared_ptr");
+            root->InsertEndChild(elem);
+            unsigned int ref = 0;
+            if (!type_info::track_written(obj, ref)) {                                                  // nullptr or written before
+                if (ref != 0) elem->SetAttribute("ref", ref);
+                return 1;
+            }
+            elem->SetAttribute("id", ref);
+            return write_xml(*obj, "object", elem);
         } else if constexpr (std::is_array<RR(T)>::value) {                                                     // array type
-            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
             root->InsertEndChild(elem);
             unsigned int size = 1;
             for (int i = 0; i < (int)std::extent<RR(T)>::value; ++ i) {
                 size += write_xml(obj[i], "element", elem);
             }
             return size;
-        } else if constexpr (std::is_same<RR(T), std::string>::value) {                                         // string type
-            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+        } else if constexpr (my_type_traits::is_string<RR(T)>::value) {                                         // string type
+            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
             tinyxml2::XMLText* text = root->GetDocument()->NewText(obj.c_str());
             elem->InsertEndChild(text);
             root->InsertEndChild(elem);
             return 1;
         } else if constexpr (my_type_traits::is_pair<RR(T)>::value) {                                           // pair type    
             unsigned int size = 1;
-            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
             root->InsertEndChild(elem);
             size += write_xml(obj.first, "first", elem);
             size += write_xml(obj.second, "second", elem);
             return size;
         } else if constexpr (my_type_traits::is_container<RR(T)>::value) {                                      // container type
             unsigned int size = 1;
-            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name.c_str());
+            tinyxml2::XMLElement *elem = root->GetDocument()->NewElement(name);
             root->InsertEndChild(elem);
-            for (auto i : obj) {
+            for (const auto &i : obj) {
                 size += write_xml(i, "element", elem);
             }
             return size;
         } else if constexpr (std::is_class<RR(T)>::value) {                                                     // user defined class type
-            std::string typenm = type_info::demangle(T());
-            if (type_info::type_writer_xml.find(typenm) == type_info::type_writer_xml.end()) {
-                std::cerr << "type " << typenm << " not registered" << std::endl;
-                throw std::runtime_error("type not registered");
-            }
-            return type_info::type_writer_xml[typenm]((void *)&obj, name, root);
+            return type_info::dispatch<RR(T)>::writer_xml()((void *)&obj, name, root);
         } else {
             throw std::runtime_error("Unsupported type");
         }
@@ -94,24 +108,38 @@ namespace xml_srl {
      * @return the input size of xml data
      */
     template<class T>
-    unsigned int read_xml(T &obj, std::string name, tinyxml2::XMLElement *root, int itself = 0) {
+    unsigned int read_xml(T &obj, const char *name, tinyxml2::XMLElement *root, int itself = 0) {
+        type_info::identity_scope identity(!std::is_arithmetic<RR(T)>::value);
         tinyxml2::XMLElement *elem = root;
         if (!itself) {
-            elem = root->FirstChildElement(name.c_str());
+            elem = root->FirstChildElement(name);
         }
-        if constexpr (std::is_arithmetic<RR(T)>::value && !std::is_floating_point<RR(T)>::value) {
-            obj = std::stoi(elem->Attribute("val"));
-            return 1;
-        } else if constexpr (std::is_floating_point<RR(T)>::value) {
-            obj = std::stod(elem->Attribute("val"));
+        if constexpr (std::is_arithmetic<RR(T)>::value) {
+            my_type_traits::xml_arith_t<RR(T)> val{};
+            if (elem->QueryAttribute("val", &val) != tinyxml2::XML_SUCCESS) {
+                std::cerr << "invalid value of " << name << std::endl;
+                throw std::runtime_error("invalid value");
+            }
+            obj = static_cast<RR(T)>(val);
             return 1;
         } else if constexpr (my_type_traits::is_unique_ptr<RR(T)>::value) {
             obj = std::unique_ptr<typename T::element_type>(new typename T::element_type());
             return read_xml(*obj, "object", elem);
-        } else if constexpr (std::is_pointer<RR(T)>::value) {
+        } else if constexpr (std::is_pointer<RR(T)>::value || my_type_traits::is_shared_ptr<RR(T)>::value) {
             // memory leak!!!
-            obj = new typename std::remove_pointer<T>::type();
-            return read_xml(*obj, "object", elem);
+            unsigned int ref = 0;
+            if (elem->QueryUnsignedAttribute("ref", &ref) == tinyxml2::XML_SUCCESS) {                  // one read before
+                obj = type_info::tracked<RR(T)>(ref);
+                return 1;
+            }
+            if (elem->FirstChildElement("object") == nullptr) {
+                obj = nullptr;
+                return 1;
+            }
+            type_info::skip_to_id<RR(T)>(elem->UnsignedAttribute("id"));
+            auto target = type_info::track_new<RR(T)>();
+            obj = target;
+            return read_xml(*target, "object", elem);
         } else if constexpr (std::is_array<RR(T)>::value) {
             unsigned int size = 1;
             tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
@@ -120,7 +148,7 @@ namespace xml_srl {
                 elit = elit->NextSiblingElement();
             }
             return size;
-        } else if constexpr (std::is_same<RR(T), std::string>::value) {
+        } else if constexpr (my_type_traits::is_string<RR(T)>::value) {
             obj = elem->GetText();
             return 1;
         } else if constexpr (my_type_traits::is_pair<RR(T)>::value) {
@@ -132,50 +160,44 @@ namespace xml_srl {
             unsigned int size = 1;                                                                      // so we need to use different functions
             tinyxml2::XMLElement *elit = elem->FirstChildElement("element");                            // do the iteration in this layer
             while (elit) {                                                                              // it's not a wise design but it works
-                typename std::remove_cv<typename T::value_type>::type it;
+                auto it = type_info::make_element<RR(typename T::value_type)>(type_info::allocator_of(obj));
                 size += read_xml(it, "element", elit, 1);
                 elit = elit->NextSiblingElement();
-                obj.push_back(it);
+                obj.push_back(std::move(it));
             }
             return size;
         } else if constexpr (my_type_traits::is_set<RR(T)>::value) {
             unsigned int size = 1;
             tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
             while (elit) {
-                typename std::remove_cv<typename T::value_type>::type it;
+                auto it = type_info::make_element<RR(typename T::value_type)>(type_info::allocator_of(obj));
                 size += read_xml(it, "element", elit, 1);
                 elit = elit->NextSiblingElement();
-                obj.insert(it);
+                obj.insert(std::move(it));
             }
             return size;
         } else if constexpr (my_type_traits::is_map<RR(T)>::value) {
             unsigned int size = 1;
             tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
             while (elit) {
-                std::pair<typename std::remove_cv<typename T::key_type>::type,
-                    typename std::remove_cv<typename T::mapped_type>::type> it;
+                auto it = type_info::make_element<my_type_traits::mutable_value_t<typename T::value_type>>(type_info::allocator_of(obj));
                 size += read_xml(it, "element_pair", elit, 1);
                 elit = elit->NextSiblingElement();
-                obj.insert(it);
+                obj.insert(std::move(it));
             }
             return size;
         } else if constexpr (my_type_traits::is_container_adaptor<RR(T)>::value) {
             unsigned int size = 1;
             tinyxml2::XMLElement *elit = elem->FirstChildElement("element");
             while (elit) {
-                typename std::remove_cv<typename T::value_type>::type it;
+                auto it = type_info::make_element<RR(typename T::value_type)>(type_info::allocator_of(obj));
                 size += read_xml(it, "element", elit, 1);
                 elit = elit->NextSiblingElement();
-                obj.push(it);
+                obj.push(std::move(it));
             }
             return size;
         } else if constexpr (std::is_class<RR(T)>::value) {
-            std::string typenm = type_info::demangle(T());
-            if (type_info::type_reader_xml.find(typenm) == type_info::type_reader_xml.end()) {
-                std::cerr << "type " << typenm << " not registered" << std::endl;
-                throw std::runtime_error("type not registered");
-            }
-            return type_info::type_reader_xml[typenm]((void *)&obj, name, root, 0);
+            return type_info::dispatch<RR(T)>::reader_xml()((void *)&obj, name, root, itself);
         } else {
             throw std::runtime_error("Unsupported type");
         }
@@ -196,7 +218,7 @@ namespace xml_srl {
         int err = file.Parse(declaration);
         tinyxml2::XMLElement* root = file.NewElement("serialization");
         file.InsertEndChild(root);
-        unsigned int size = write_xml(obj, name, root);
+        unsigned int size = write_xml(obj, name.c_str(), root);
         err = file.SaveFile(file_name);
         if (err != 0) {
             std::cerr << "Error saving xml file" << std::endl;
@@ -221,8 +243,742 @@ namespace xml_srl {
             throw std::runtime_error("Error opening xml file");
         }
         tinyxml2::XMLElement* root = file.FirstChildElement("serialization");
-        unsigned int size = read_xml(obj, name, root);
+        unsigned int size = read_xml(obj, name.c_str(), root);
         err = file.SaveFile(file_name);
         return size;
     }
+
+    /**
+     * @brief xml deserialization entry point, reading into a memory resource
+     * The objects raw pointers point to are allocated from resource and are
+     * not to be deleted. The elements of std::pmr containers are built with
+     * the allocator of their container.
+     * @param obj
+     * @param name name of the outer element
+     * @param file_name
+     * @param resource
+     * @return the input size of xml data
+     */
+    template<class T>
+    unsigned int deserialize(T &obj, std::string name, const char *file_name, std::pmr::memory_resource *resource) {
+        type_info::resource_scope scope(resource);
+        return deserialize(obj, name, file_name);
+    }
+
+    /**
+     * @brief xml serialization output entry point, compressed in blocks
+     * The printed document goes through block_stream::writer_buf.
+     * @param obj
+     * @param name name of the outer element
+     * @param file_name
+     * @param opt the block size and codec, recorded in the file
+     * @return the output size of xml data
+     */
+    template<class T>
+    unsigned int serialize_compressed(const T& obj, std::string name, const char *file_name,
+                                      const block_stream::options &opt = block_stream::options()) {
+        tinyxml2::XMLDocument doc;
+        doc.InsertEndChild(doc.NewDeclaration());
+        tinyxml2::XMLElement* root = doc.NewElement("serialization");
+        doc.InsertEndChild(root);
+        unsigned int size = write_xml(obj, name.c_str(), root);
+        tinyxml2::XMLPrinter printer;
+        doc.Print(&printer);
+        std::ofstream file(file_name, std::ios::binary | std::ios::out);
+        if (!file.is_open()) {
+            std::cerr << "Error saving xml file" << std::endl;
+            throw std::runtime_error("Error saving xml file");
+        }
+        block_stream::writer_buf blocks(file, opt);
+        blocks.sputn(printer.CStr(), printer.CStrSize() - 1);
+        if (!blocks.finish()) {
+            std::cerr << "Error saving xml file" << std::endl;
+            throw std::runtime_error("Error saving xml file");
+        }
+        return size;
+    }
+
+    /**
+     * @brief xml deserialization input entry point for files written by serialize_compressed
+     * The file is decompressed into memory in front of XMLDocument::Parse.
+     * @param obj
+     * @param name name of the outer element
+     * @param file_name
+     * @return the input size of xml data
+     */
+    template<class T>
+    unsigned int deserialize_compressed(T &obj, std::string name, const char *file_name) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening xml file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening xml file");
+        }
+        block_stream::reader_buf blocks(file);
+        std::string xml((std::istreambuf_iterator<char>(&blocks)), std::istreambuf_iterator<char>());
+        tinyxml2::XMLDocument doc;
+        if (blocks.failed() || doc.Parse(xml.data(), xml.size()) != tinyxml2::XML_SUCCESS) {
+            std::cerr << "Error reading compressed xml file: " << file_name << std::endl;
+            throw std::runtime_error("Error reading compressed xml file");
+        }
+        tinyxml2::XMLElement* root = doc.FirstChildElement("serialization");
+        return read_xml(obj, name.c_str(), root);
+    }
+
+    /**
+     * @brief deserialize a batch of documents concurrently
+     * The documents are spread over a work stealing pool. Every worker keeps
+     * one XMLDocument and reuses it, with its node pools, for all the
+     * documents it parses, and reads in the modes of the calling thread. The
+     * types must be registered before the call.
+     * @param objs resized to n, objs[i] is read from document i
+     * @param n the number of documents
+     * @param name name of the outer element
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @param load load(doc, i) loads document i into doc and returns the error
+     * @param what load(doc, i) names document i for the error message
+     * @return the input size of xml data
+     */
+    template<class T, class Load, class What>
+    unsigned int deserialize_batch_(std::vector<T> &objs, size_t n, const std::string &name, unsigned int threads, Load load, What what) {
+        type_info::freeze();                                                                        // lock-free type lookup on the workers
+        objs.clear();
+        objs.resize(n);
+        threads = parallel::thread_count(threads);
+        std::vector<std::unique_ptr<tinyxml2::XMLDocument>> docs(threads);
+        std::vector<unsigned int> sizes(n, 0);
+        const type_info::thread_modes modes = type_info::current_modes();
+        parallel::work_stealing_for(n, threads, [&](unsigned int worker, size_t i) {
+            type_info::modes_scope scope(modes);
+            if (!docs[worker]) {
+                docs[worker].reset(new tinyxml2::XMLDocument());
+            }
+            tinyxml2::XMLDocument &file = *docs[worker];
+            if (load(file, i) != 0) {
+                std::cerr << "Error opening xml file: " << what(i) << std::endl;
+                throw std::runtime_error("Error opening xml file");
+            }
+            tinyxml2::XMLElement* root = file.FirstChildElement("serialization");
+            if (root == nullptr) {
+                std::cerr << "No serialization element in " << what(i) << std::endl;
+                throw std::runtime_error("No serialization element");
+            }
+            sizes[i] = read_xml(objs[i], name.c_str(), root);
+        });
+        unsigned int size = 0;
+        for (size_t i = 0; i < n; ++ i) {
+            size += sizes[i];
+        }
+        return size;
+    }
+
+    /**
+     * @brief deserialize a batch of xml files concurrently
+     * @param objs resized to the number of files, results are in input order
+     * @param file_names
+     * @param name name of the outer element
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @return the input size of xml data
+     */
+    template<class T>
+    unsigned int deserialize_batch(std::vector<T> &objs, const std::vector<std::string> &file_names, std::string name, unsigned int threads = 0) {
+        return deserialize_batch_(objs, file_names.size(), name, threads,
+            [&](tinyxml2::XMLDocument &file, size_t i) { return file.LoadFile(file_names[i].c_str()); },
+            [&](size_t i) { return file_names[i]; });
+    }
+
+    /**
+     * @brief deserialize a batch of in-memory xml documents concurrently
+     * @param objs resized to the number of buffers, results are in input order
+     * @param buffers the xml text of each document
+     * @param name name of the outer element
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @return the input size of xml data
+     */
+    template<class T>
+    unsigned int parse_batch(std::vector<T> &objs, const std::vector<std::string> &buffers, std::string name, unsigned int threads = 0) {
+        return deserialize_batch_(objs, buffers.size(), name, threads,
+            [&](tinyxml2::XMLDocument &file, size_t i) { return file.Parse(buffers[i].data(), buffers[i].size()); },
+            [&](size_t i) { return "buffer " + std::to_string(i); });
+    }
+
+    /**
+     * @brief where the children of the element split by scan_children are
+     * @param begin the start of the element's content
+     * @param end the start of its end tag
+     * @param children the start of each child element
+     * @param lines the number of newlines in front of each child element
+     * @param begin_line the number of newlines in front of the content
+     * @param content_lines the number of newlines in the content
+     */
+    struct child_scan {
+        size_t begin = 0, end = 0;
+        std::vector<size_t> children;
+        std::vector<int> lines;
+        int begin_line = 0, content_lines = 0;
+    };
+
+    /**
+     * @brief find the children of the first element named split without parsing them
+     * Only tags, attribute quoting and processing instructions are followed.
+     * @param xml
+     * @param len
+     * @param split
+     * @param scan
+     * @return false if there is no such element, it is empty, or the text holds
+     * a comment, CDATA section or DTD which the scan does not follow
+     */
+    inline bool scan_children(const char *xml, size_t len, const char *split, child_scan &scan) {
+        size_t split_len = strlen(split);
+        int depth = 0, split_depth = -1, line = 0;
+        size_t i = 0;
+        auto skip_to = [&](char ch) {                                                               // skip to just past ch
+            char quote = 0;
+            for (; i < len; ++ i) {
+                if (xml[i] == '\n') ++ line;
+                if (quote) {
+                    if (xml[i] == quote) quote = 0;
+                } else if (xml[i] == '"' || xml[i] == '\'') {
+                    quote = xml[i];
+                } else if (xml[i] == ch) {
+                    ++ i;
+                    return true;
+                }
+            }
+            return false;
+        };
+        while (i < len) {
+            if (xml[i] != '<') {
+                if (xml[i] == '\n') ++ line;
+                ++ i;
+                continue;
+            }
+            if (i + 1 >= len || xml[i + 1] == '!') {                                                // comment, CDATA or DTD
+                return false;
+            }
+            if (xml[i + 1] == '?') {                                                                // declaration
+                const char *close = "?>";
+                const char *pi = std::search(xml + i, xml + len, close, close + 2);
+                if (pi == xml + len) return false;
+                line += std::count(xml + i, pi, '\n');
+                i = pi - xml + 2;
+                continue;
+            }
+            if (xml[i + 1] == '/') {                                                                // end tag
+                if (-- depth == split_depth) {
+                    scan.end = i;
+                    scan.content_lines = line - scan.begin_line;
+                    return scan.children.size() > 0;
+                }
+                if (!skip_to('>')) return false;
+                continue;
+            }
+            if (split_depth >= 0 && depth == split_depth + 1) {                                     // a child of the split element
+                scan.children.push_back(i);
+                scan.lines.push_back(line);
+            }
+            size_t name = i + 1;
+            if (!skip_to('>')) return false;
+            bool empty = xml[i - 2] == '/';
+            if (split_depth < 0 && strncmp(xml + name, split, split_len) == 0 &&
+                strchr(" \t\r\n/>", xml[name + split_len]) != nullptr) {
+                if (empty) return false;
+                split_depth = depth;
+                scan.begin = i;
+                scan.begin_line = line;
+            }
+            if (!empty) ++ depth;
+        }
+        return false;
+    }
+
+    /**
+     * @brief parse an xml document, splitting the children of one element across threads
+     * The children of the first element named split are cut into ranges which
+     * are parsed concurrently, each into its own XMLDocument, and then linked
+     * under that element in doc (see XMLDocument::AdoptChildren). The rest of
+     * the document is parsed on its own. If the split can't be done safely or
+     * a range fails to parse, the whole text is parsed sequentially instead,
+     * so errors are reported as by XMLDocument::Parse.
+     * @param doc
+     * @param xml
+     * @param len
+     * @param split the name of the element whose children are split
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @return the error of the parse
+     */
+    inline tinyxml2::XMLError parse_parallel(tinyxml2::XMLDocument &doc, const char *xml, size_t len,
+                                             const char *split = "serialization", unsigned int threads = 0) {
+        threads = parallel::thread_count(threads);
+        child_scan scan;
+        if (threads <= 1 || !scan_children(xml, len, split, scan) || scan.children.size() < 2) {
+            return doc.Parse(xml, len);
+        }
+
+        // cut the content into ranges of whole children, a few per thread
+        std::vector<size_t> cuts(1, scan.begin);
+        std::vector<int> cut_lines(1, scan.begin_line);
+        size_t target = (scan.end - scan.begin) / (threads * 4) + 1;
+        for (size_t k = 1; k < scan.children.size(); ++ k) {
+            if (scan.children[k] - cuts.back() >= target) {
+                cuts.push_back(scan.children[k]);
+                cut_lines.push_back(scan.lines[k]);
+            }
+        }
+        cuts.push_back(scan.end);
+
+        // the document without the content, newlines kept so the line numbers stay right
+        std::string skeleton(xml, scan.begin);
+        skeleton.append(scan.content_lines, '\n');
+        skeleton.append(xml + scan.end, len - scan.end);
+        if (doc.Parse(skeleton.data(), skeleton.size()) != tinyxml2::XML_SUCCESS) {
+            return doc.Parse(xml, len);
+        }
+        tinyxml2::XMLElement *parent = doc.FirstChildElement();
+        while (parent != nullptr && strcmp(parent->Name(), split) != 0) {                           // the first one in document order
+            if (parent->FirstChildElement() != nullptr) {
+                parent = parent->FirstChildElement();
+                continue;
+            }
+            while (parent != nullptr && parent->NextSiblingElement() == nullptr) {
+                parent = parent->Parent() ? parent->Parent()->ToElement() : nullptr;
+            }
+            if (parent != nullptr) parent = parent->NextSiblingElement();
+        }
+        if (parent == nullptr) {
+            return doc.Parse(xml, len);
+        }
+
+        size_t n = cuts.size() - 1;
+        std::vector<std::unique_ptr<tinyxml2::XMLDocument>> parts(n);
+        std::atomic<bool> failed(false);
+        parallel::parallel_for(n, threads, [&](size_t k) {
+            parts[k].reset(new tinyxml2::XMLDocument(doc.ProcessEntities(), doc.WhitespaceMode()));
+            if (parts[k]->Parse(xml + cuts[k], cuts[k + 1] - cuts[k]) != tinyxml2::XML_SUCCESS) {
+                failed = true;
+                return;
+            }
+            parts[k]->PrepareAdoption(parent, cut_lines[k]);
+        });
+        if (failed) {
+            parts.clear();
+            return doc.Parse(xml, len);
+        }
+        for (size_t k = 0; k < n; ++ k) {
+            doc.AdoptChildren(parts[k].release());
+        }
+        return doc.ErrorID();
+    }
+
+    /**
+     * @brief load an xml file with parse_parallel
+     * @param doc
+     * @param file_name
+     * @param split the name of the element whose children are split
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @return the error of the parse
+     */
+    inline tinyxml2::XMLError load_parallel(tinyxml2::XMLDocument &doc, const char *file_name,
+                                            const char *split = "serialization", unsigned int threads = 0) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.is_open()) {
+            doc.Clear();
+            return tinyxml2::XML_ERROR_FILE_NOT_FOUND;
+        }
+        std::string xml((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return parse_parallel(doc, xml.data(), xml.size(), split, threads);
+    }
+
+    /**
+     * @brief xml deserialization input entry point for large documents
+     * The children of the outer element are parsed in parallel, see parse_parallel.
+     * @param obj
+     * @param name name of the outer element
+     * @param file_name
+     * @param threads the number of threads, 0 means one per hardware thread
+     * @param finalize move the nodes of the parsed document, which are spread
+     * over the pools of every worker, into one block before reading them, see
+     * XMLDocument::Finalize. Worth it when the elements are wide.
+     * @return the input size of xml data
+     */
+    template<class T>
+    unsigned int deserialize_parallel(T &obj, std::string name, const char *file_name, unsigned int threads = 0,
+                                      bool finalize = false) {
+        tinyxml2::XMLDocument file;
+        int err = load_parallel(file, file_name, name.c_str(), threads);
+        if (err != 0) {
+            std::cerr << "Error opening xml file: " << file_name << std::endl;
+            throw std::runtime_error("Error opening xml file");
+        }
+        if (finalize) {
+            file.Finalize();
+        }
+        tinyxml2::XMLElement* root = file.FirstChildElement("serialization");
+        return read_xml(obj, name.c_str(), root);
+    }
+
+    /**
+     * @brief write a container element by element, without having it in memory
+     * The document is printed as it goes. Each element is built in a scratch
+     * document, printed and deleted, so the file is the same as the one
+     * serialize writes for a container of the pushed elements. Pointers keep
+     * their identity across the elements.
+     */
+    template<class T>
+    class sequence_writer {
+    public:
+        /**
+         * @param name name of the outer element
+         * @param file_name
+         */
+        sequence_writer(std::string name, const char *file_name)
+            : name(name), file_name(file_name), file(fopen(file_name, "w")), printer(file) {
+            if (file == nullptr) {
+                std::cerr << "Error opening xml file: " << file_name << std::endl;
+                throw std::runtime_error("Error opening xml file");
+            }
+            printer.PushDeclaration("xml version=\"1.0\" encoding=\"UTF-8\"");
+            printer.OpenElement("serialization");
+            printer.OpenElement(this->name.c_str());                                                   // the printer keeps the pointer
+            root = scratch.NewElement(name.c_str());
+            scratch.InsertEndChild(root);
+        }
+        sequence_writer(const sequence_writer &) = delete;
+        sequence_writer &operator=(const sequence_writer &) = delete;
+        ~sequence_writer() {
+            finish_();
+        }
+
+        /**
+         * @brief write the next element
+         * @param obj
+         * @return the output size of the element
+         */
+        unsigned int push(const T &obj) {
+            type_info::identity_scope identity(identities);
+            unsigned int n = write_xml(obj, "element", root);
+            root->FirstChildElement()->Accept(&printer);
+            root->DeleteChildren();
+            size += n;
+            return n;
+        }
+
+        /**
+         * @brief close the outer elements and the file
+         * @return the output size of xml data
+         */
+        unsigned int end() {
+            if (!finish_()) {
+                std::cerr << "Error saving xml file: " << file_name << std::endl;
+                throw std::runtime_error("Error saving xml file");
+            }
+            return size;
+        }
+
+    private:
+        bool finish_() {
+            if (file == nullptr) {
+                return true;
+            }
+            printer.CloseElement();
+            printer.CloseElement();
+            bool ok = !ferror(file);
+            ok = fclose(file) == 0 && ok;
+            file = nullptr;
+            return ok;
+        }
+
+        std::string name, file_name;
+        FILE *file;
+        tinyxml2::XMLPrinter printer;
+        tinyxml2::XMLDocument scratch;
+        tinyxml2::XMLElement *root;
+        unsigned int size = 1;
+        type_info::identity_table identities;                                                           // one pass over all the elements
+    };
+
+    /**
+     * @brief reads the tags of an xml file one after the other, without parsing it
+     * The file is read in blocks. Quoting, comments, CDATA sections and
+     * processing instructions are followed, so the tags found are the ones
+     * tinyxml2 would find. The text of the tags and the text between them
+     * can be copied out, to be parsed on its own.
+     */
+    class tag_scanner {
+    public:
+        enum { tag_eof, tag_start, tag_empty, tag_end, tag_other };
+
+        explicit tag_scanner(const char *file_name) : block(1 << 16) {
+            file.open(file_name, std::ios::binary);
+            if (!file.is_open()) {
+                std::cerr << "Error opening xml file: " << file_name << std::endl;
+                throw std::runtime_error("Error opening xml file");
+            }
+        }
+
+        /**
+         * @brief move into the element named name in <serialization>, see serialize
+         * @param name
+         * @return false if the element is empty, throws if there is none
+         */
+        bool enter(const std::string &name) {
+            int depth = 0;
+            bool root = false;
+            for (;;) {
+                int tag = next(nullptr);
+                if (tag == tag_eof) {
+                    std::cerr << "Error finding " << name << " in the xml file" << std::endl;
+                    throw std::runtime_error("Error finding element");
+                }
+                if (tag == tag_start || tag == tag_empty) {
+                    if (depth == 0) {
+                        root = tag_name == "serialization";
+                    } else if (depth == 1 && root && tag_name == name) {
+                        return tag == tag_start;
+                    }
+                    if (tag == tag_start) ++ depth;
+                } else if (tag == tag_end) {
+                    -- depth;
+                }
+            }
+        }
+
+        /**
+         * @brief read up to and including the next tag
+         * @param out the characters read are appended to it if it is not null
+         * @return the kind of the tag, its name is in name()
+         */
+        int next(std::string *out) {
+            int c;
+            while ((c = get_()) != '<') {                                                               // text in front of the tag
+                if (c < 0) return tag_eof;
+                if (out) out->push_back((char)c);
+            }
+            if (out) out->push_back('<');
+            if ((c = get_()) < 0) return tag_eof;
+            if (out) out->push_back((char)c);
+            if (c == '?') {                                                                             // declaration
+                return skip_past_("?>", out) ? tag_other : tag_eof;
+            }
+            if (c == '!') {                                                                             // comment, CDATA or DTD
+                if ((c = get_()) < 0) return tag_eof;
+                if (out) out->push_back((char)c);
+                const char *close = c == '-' ? "-->" : c == '[' ? "]]>" : ">";
+                return skip_past_(close, out) ? tag_other : tag_eof;
+            }
+            bool end = c == '/', in_name = !end;
+            tag_name.assign(end ? 0 : 1, (char)c);
+            char quote = 0;
+            int last = c;
+            for (;;) {
+                if ((c = get_()) < 0) return tag_eof;
+                if (out) out->push_back((char)c);
+                if (quote) {
+                    if (c == quote) quote = 0;
+                } else if (c == '"' || c == '\'') {
+                    quote = (char)c;
+                } else if (c == '>') {
+                    break;
+                }
+                if (strchr(" \t\r\n/>", c) != nullptr) {
+                    in_name = false;
+                } else if (in_name || (end && tag_name.empty())) {
+                    tag_name.push_back((char)c);
+                    in_name = true;
+                }
+                last = c;
+            }
+            return end ? tag_end : last == '/' ? tag_empty : tag_start;
+        }
+
+        /**
+         * @brief read the rest of the element whose start tag next() just read
+         * @param tag what next() returned
+         * @param out the characters read are appended to it if it is not null
+         * @return false if the file ends first
+         */
+        bool finish_element(int tag, std::string *out) {
+            for (int depth = tag == tag_start; depth > 0; ) {
+                tag = next(out);
+                if (tag == tag_eof) return false;
+                if (tag == tag_start) ++ depth;
+                if (tag == tag_end) -- depth;
+            }
+            return tag != tag_eof;
+        }
+
+        // the name of the last start or end tag
+        const std::string &name() const {
+            return tag_name;
+        }
+
+    private:
+        // the next character of the file, -1 at its end
+        int get_() {
+            if (pos == len) {
+                file.read(block.data(), block.size());
+                len = file.gcount();
+                pos = 0;
+                if (len == 0) return -1;
+            }
+            return (unsigned char)block[pos ++];
+        }
+
+        // read up to and including close, the characters go to out if it is not null
+        bool skip_past_(const char *close, std::string *out) {
+            std::string tail;
+            size_t n = strlen(close);
+            for (int c = get_(); c >= 0; c = get_()) {
+                if (out) out->push_back((char)c);
+                tail.push_back((char)c);
+                if (tail.size() > n) tail.erase(0, 1);
+                if (tail == close) return true;
+            }
+            return false;
+        }
+
+        std::ifstream file;
+        std::vector<char> block;
+        size_t pos = 0, len = 0;
+        std::string tag_name;
+    };
+
+    /**
+     * @brief read the elements of a container in an xml file one at a time
+     * The file is one written by serialize for a container of T, or a
+     * std::pair<K, V> for a map. A tag_scanner cuts out one child of the
+     * outer element at a time. That child alone is parsed by tinyxml2 and
+     * read with read_xml, so only the element being read is held in memory.
+     * Pointers keep their identity across the elements, as they do when the
+     * whole container is read.
+     */
+    template<class T>
+    class sequence_reader {
+    public:
+        typedef T value_type;
+        typedef type_info::sequence_iterator<sequence_reader> iterator;
+
+        /**
+         * @param name name of the outer element
+         * @param file_name
+         */
+        sequence_reader(std::string name, const char *file_name) : file_name(file_name), scanner(file_name) {
+            finished = !scanner.enter(name);
+        }
+        sequence_reader(const sequence_reader &) = delete;
+        sequence_reader &operator=(const sequence_reader &) = delete;
+
+        /**
+         * @brief read the next element
+         * @param obj replaced by the element
+         * @return false after the last element
+         */
+        bool next(T &obj) {
+            if (finished) {
+                return false;
+            }
+            int tag;
+            do {                                                                                        // skip to the next child or the end tag
+                text.clear();
+                tag = scanner.next(&text);
+            } while (tag == tag_scanner::tag_other);
+            if (tag == tag_scanner::tag_end) {
+                finished = true;
+                return false;
+            }
+            if (!scanner.finish_element(tag, &text) || doc.Parse(text.data(), text.size()) != tinyxml2::XML_SUCCESS) {
+                std::cerr << "Error reading element of " << file_name << std::endl;
+                throw std::runtime_error("Error reading element");
+            }
+            type_info::identity_scope identity(identities);
+            T element{};
+            read_xml(element, "element", doc.RootElement(), 1);
+            obj = std::move(element);
+            return true;
+        }
+
+        // the elements not read yet, the reader is shared by its iterators
+        iterator begin() {
+            return iterator(this);
+        }
+        iterator end() {
+            return iterator();
+        }
+
+    private:
+        std::string file_name;
+        tag_scanner scanner;
+        std::string text;
+        bool finished = false;
+        tinyxml2::XMLDocument doc;
+        type_info::identity_table identities;                                                           // one pass over all the elements
+    };
+
+    // read the members of a registered struct a projection wants, the others are not in elem
+    inline unsigned int read_projected_(void *obj, const type_info::typeInfo &info, const std::vector<std::string> &paths,
+                                        tinyxml2::XMLElement *elem) {
+        type_info::check_projection(paths, info);
+        unsigned int size = 1;
+        std::vector<std::string> sub;
+        for (const auto &member : info.members) {
+            char *dat = reinterpret_cast<char *>(obj) + member.offset;
+            if (type_info::project_member(paths, member.name, sub)) {
+                size += member.reader_xml(dat, member.name.c_str(), elem, 0);
+            } else if (!sub.empty()) {
+                const type_info::typeInfo *inner = type_info::typeInfo_map.find(member.typenm);
+                if (inner == nullptr) {
+                    std::cerr << "Member " << member.name << " of " << info.name << " is not a registered struct" << std::endl;
+                    throw std::runtime_error("Not a registered struct");
+                }
+                size += read_projected_(dat, *inner, sub, elem->FirstChildElement(member.name.c_str()));
+            }
+        }
+        return size;
+    }
+
+    /**
+     * @brief xml deserialization of some members of a registered struct
+     * A tag_scanner passes over the elements of the members not named, so
+     * they are never parsed or built, and only the members named go to
+     * tinyxml2. The others keep their values. Pointers into a member passed
+     * over can't be followed from the members read, which throws.
+     * @param obj
+     * @param name name of the outer element
+     * @param file_name
+     * @param members the names of the members to read, a member of a member as "inner.name"
+     * @return the input size of xml data read
+     */
+    template<class T>
+    unsigned int deserialize_projection(T &obj, std::string name, const char *file_name, const std::vector<std::string> &members) {
+        const type_info::typeInfo &info = type_info::dispatch<RR(T)>::info();
+        type_info::check_projection(members, info);
+        tag_scanner scanner(file_name);
+        std::string kept = "<" + name + ">";
+        if (scanner.enter(name)) {
+            for (;;) {
+                size_t mark = kept.size();
+                int tag = scanner.next(&kept);
+                if (tag == tag_scanner::tag_other || tag == tag_scanner::tag_end) {
+                    kept.resize(mark);
+                    if (tag == tag_scanner::tag_end) break;
+                    continue;
+                }
+                bool wanted = std::any_of(members.begin(), members.end(), [&](const std::string &path) {
+                    return path.compare(0, path.find('.'), scanner.name()) == 0;
+                });
+                if (!wanted) kept.resize(mark);
+                if (tag == tag_scanner::tag_eof || !scanner.finish_element(tag, wanted ? &kept : nullptr)) {
+                    std::cerr << "Error reading xml file: " << file_name << std::endl;
+                    throw std::runtime_error("Error reading xml file");
+                }
+            }
+        }
+        kept += "</" + name + ">";
+        tinyxml2::XMLDocument doc;
+        if (doc.Parse(kept.data(), kept.size()) != tinyxml2::XML_SUCCESS) {
+            std::cerr << "Error reading xml file: " << file_name << std::endl;
+            throw std::runtime_error("Error reading xml file");
+        }
+        type_info::identity_scope identity;
+        return read_projected_(&obj, info, members, doc.RootElement());
+    }
 }
\ No newline at end of file
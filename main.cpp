@@ -7,11 +7,88 @@
 #include <list>
 #include <memory>
 #include <cassert>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <memory_resource>
 #include "bin_srl.h"
 #include "xml_srl.h"
 #include "type_info.h"
 #include "tinyxml2.h"
 
+/**
+ * @brief count the heap allocations, the serialization core should make none per element
+ * Every form of the global operator new and delete is replaced, so they all
+ * go through malloc and free and none is paired with the library's own.
+ */
+static std::atomic<size_t> allocations(0);
+static void *allocate_(size_t size, size_t align, bool nothrow) {
+    ++ allocations;
+    if (size == 0) size = 1;
+    void *ptr = align <= alignof(std::max_align_t) ? malloc(size) : aligned_alloc(align, (size + align - 1) / align * align);
+    if (ptr == nullptr && !nothrow) throw std::bad_alloc();
+    return ptr;
+}
+__attribute__((noinline)) static void release_(void *ptr) noexcept {
+    free(ptr);
+}
+void *operator new(size_t size) { return allocate_(size, 0, false); }
+void *operator new[](size_t size) { return allocate_(size, 0, false); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate_(size, 0, true); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate_(size, 0, true); }
+void *operator new(size_t size, std::align_val_t al) { return allocate_(size, (size_t)al, false); }
+void *operator new[](size_t size, std::align_val_t al) { return allocate_(size, (size_t)al, false); }
+void *operator new(size_t size, std::align_val_t al, const std::nothrow_t &) noexcept { return allocate_(size, (size_t)al, true); }
+void *operator new[](size_t size, std::align_val_t al, const std::nothrow_t &) noexcept { return allocate_(size, (size_t)al, true); }
+void operator delete(void *ptr) noexcept { release_(ptr); }
+void operator delete[](void *ptr) noexcept { release_(ptr); }
+void operator delete(void *ptr, size_t) noexcept { release_(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { release_(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { release_(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { release_(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { release_(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { release_(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { release_(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { release_(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { release_(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { release_(ptr); }
+
+/**
+ * @brief a check that holds in release builds too, where assert is compiled out
+ * @param ok
+ * @param what printed when the check fails, then the test driver exits with 1
+ */
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        std::cerr << "Check failed: " << what << std::endl;
+        std::exit(1);
+    }
+}
+
+/**
+ * @brief a thread safe memory resource that counts the blocks it hands out
+ */
+class counting_resource : public std::pmr::memory_resource {
+public:
+    std::atomic<size_t> count{0};
+
+private:
+    std::pmr::synchronized_pool_resource pool_;
+    void *do_allocate(size_t bytes, size_t align) override {
+        ++ count;
+        return pool_.allocate(bytes, align);
+    }
+    void do_deallocate(void *ptr, size_t bytes, size_t align) override {
+        pool_.deallocate(ptr, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
 /**
  * @brief the struct for testing. It contains various vals.
  */
@@ -26,6 +103,39 @@ struct A {
     std::unique_ptr<int> h;
 };
 
+/**
+ * @brief plain structs for testing. P has no padding, Q has some.
+ */
+struct P {
+    int a;
+    float b;
+    char c[8];
+};
+struct Q {
+    char a;
+    int b;
+};
+
+/**
+ * @brief a node of a linked structure for testing, the links may be shared and form cycles
+ */
+struct Node {
+    int val;
+    Node *next;
+    std::shared_ptr<std::string> label;
+};
+
+/**
+ * @brief a struct holding other registered structs, for the indexed encoding
+ */
+struct Outer {
+    int id;
+    P inner;
+    std::vector<std::string> tags;
+    Node node;
+    double weight;
+};
+
 /**
  * @brief Set the Struct object
  * 
@@ -210,6 +320,57 @@ void test_bin_srl() {
         assert((*it) == (*it2));
     }
 
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing chunked vector" << std::endl;
+    std::vector<std::string> cv1;
+    for (int i = 0; i < 1000; ++ i) {
+        cv1.push_back(std::to_string(rand()));
+    }
+    bin_srl::chunk_options opt;
+    opt.chunk_size = 64;
+    opt.threads = 4;
+    std::cout << "Serialized size: " << bin_srl::serialize_chunked(cv1, "test.bin", opt) << std::endl;
+    std::vector<std::string> cv2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize_chunked(cv2, "test.bin", opt) << std::endl;
+    assert(cv1 == cv2);
+    std::set<int> cs1;
+    for (int i = 0; i < 1000; ++ i) {
+        cs1.insert(rand());
+    }
+    std::cout << "Serialized size: " << bin_srl::serialize_chunked(cs1, "test.bin", opt) << std::endl;
+    std::set<int> cs2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize_chunked(cs2, "test.bin", opt) << std::endl;
+    assert(cs1 == cs2);
+    {
+        std::ifstream chunked("test.bin", std::ios::binary);
+        std::set<int> cs3;
+        bin_srl::read_bin_chunked(cs3, chunked);
+        expect(cs1 == cs3, "a chunked set read from a stream differs");
+    }
+    {
+        std::fstream damaged("test.bin", std::ios::binary | std::ios::in | std::ios::out);
+        unsigned int chunks = (cs1.size() + opt.chunk_size - 1) / opt.chunk_size + 1;
+        damaged.seekp(2 * sizeof(unsigned int));
+        damaged.write(reinterpret_cast<const char *>(&chunks), sizeof(chunks));    // one chunk more than the count needs
+    }
+    bool bad_table = false;
+    try {
+        cs2.clear();
+        bin_srl::deserialize_chunked(cs2, "test.bin", opt);
+    } catch (const std::runtime_error &) {
+        bad_table = true;
+    }
+    expect(bad_table, "a chunk table with too many chunks was accepted");
+    bool bad_stream_table = false;
+    try {
+        std::ifstream damaged("test.bin", std::ios::binary);
+        cs2.clear();
+        bin_srl::read_bin_chunked(cs2, damaged);
+    } catch (const std::runtime_error &) {
+        bad_stream_table = true;
+    }
+    expect(bad_stream_table, "a chunk table with too many chunks was accepted from a stream");
+
     std::cout << "===========================" << std::endl;
     std::cout << "Testing struct" << std::endl;
     A a;
@@ -229,6 +390,30 @@ void test_bin_srl() {
     std::cout << "Deserialized size: " << bin_srl::deserialize(b, "test.bin") << std::endl;
     checkStruct(a, b);
 
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing concurrent serialization" << std::endl;
+    type_info::freeze();
+    std::ostringstream expected(std::ios::binary);
+    bin_srl::write_bin(a, expected);
+    std::vector<std::string> outputs(4);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++ t) {
+        writers.emplace_back([&a, &outputs, t]() {
+            std::ostringstream out(std::ios::binary);
+            for (int k = 0; k < 100; ++ k) {
+                out.str("");
+                bin_srl::write_bin(a, out);
+            }
+            outputs[t] = out.str();
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    for (int t = 0; t < 4; ++ t) {
+        assert(outputs[t] == expected.str());
+    }
+
     std::cout << "===========================" << std::endl;
     std::cout << "Testing smart pointer" << std::endl;
     std::unique_ptr<A> amptr = std::unique_ptr<A>(new A());
@@ -238,6 +423,558 @@ void test_bin_srl() {
     std::cout << "Deserialized size: " << bin_srl::deserialize(bmptr, "test.bin") << std::endl;
     checkStruct(*amptr, *bmptr);
 
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing plain struct" << std::endl;
+    P p;
+    type_info::RegisterStruct<P>("P", p, {
+        {"a", p.a},
+        {"b", p.b},
+        {"c", p.c}
+    });
+    Q q;
+    type_info::RegisterStruct<Q>("Q", q, {
+        {"a", q.a},
+        {"b", q.b}
+    });
+    assert(type_info::dispatch<P>::info().plain);
+    assert(!type_info::dispatch<Q>::info().plain);
+    std::vector<P> pv1(100);
+    std::vector<Q> qv1(100);
+    for (int i = 0; i < 100; ++ i) {
+        pv1[i].a = rand();
+        pv1[i].b = rand() / 7.0f;
+        for (int k = 0; k < 8; ++ k) {
+            pv1[i].c[k] = 'a' + rand() % 26;
+        }
+        qv1[i].a = 'a' + rand() % 26;
+        qv1[i].b = rand();
+    }
+    std::cout << "Serialized size: " << bin_srl::serialize(pv1, "test.bin") << std::endl;
+    std::vector<P> pv2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize(pv2, "test.bin") << std::endl;
+    assert(pv2.size() == pv1.size());
+    for (int i = 0; i < 100; ++ i) {
+        assert(pv1[i].a == pv2[i].a && pv1[i].b == pv2[i].b && memcmp(pv1[i].c, pv2[i].c, 8) == 0);
+    }
+    std::cout << "Serialized size: " << bin_srl::serialize(qv1, "test.bin") << std::endl;
+    std::vector<Q> qv2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize(qv2, "test.bin") << std::endl;
+    assert(qv2.size() == qv1.size());
+    for (int i = 0; i < 100; ++ i) {
+        assert(qv1[i].a == qv2[i].a && qv1[i].b == qv2[i].b);
+    }
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing serialized size" << std::endl;
+    static_assert(bin_srl::fixed_size<std::pair<int, double>>() == sizeof(int) + sizeof(double));
+    static_assert(bin_srl::fixed_size<std::string>() == 0);
+    std::string buf;
+    std::ostringstream sized(std::ios::binary);
+    bin_srl::write_bin(a, sized);
+    std::cout << "Serialized size: " << bin_srl::serialized_size(a) << std::endl;
+    assert(bin_srl::serialized_size(a) == sized.str().size());
+    size_t buffered = bin_srl::serialize_buffer(a, buf);
+    expect(buffered == sized.str().size() && buf == sized.str(), "a buffered struct differs from the stream output");
+    sized.str("");
+    bin_srl::write_bin(pv1, sized);
+    assert(bin_srl::serialized_size(pv1) == sized.str().size());
+    sized.str("");
+    bin_srl::write_bin(qv1, sized);
+    buffered = bin_srl::serialize_buffer(qv1, buf);
+    expect(buffered == sized.str().size() && buf == sized.str(), "a buffered vector differs from the stream output");
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing allocation free traversal" << std::endl;
+    std::string pbuf;
+    bin_srl::serialize_buffer(a, buf);
+    bin_srl::serialize_buffer(pv1, pbuf);
+    size_t before = allocations;
+    bin_srl::serialize_buffer(a, buf);                          // the buffers already have the size
+    bin_srl::serialize_buffer(pv1, pbuf);
+    std::cout << "Allocations: " << allocations - before << std::endl;
+    expect(allocations == before, "the serialization core allocated");
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing memory resource" << std::endl;
+    static char block[1 << 16];
+    std::pmr::monotonic_buffer_resource arena(block, sizeof(block), std::pmr::null_memory_resource());
+    std::pmr::vector<std::pmr::string> rv1(&arena);
+    std::pmr::map<std::pmr::string, int> rm1(&arena);
+    for (int i = 0; i < 100; ++ i) {
+        rv1.emplace_back("a string too long for small string optimization " + std::to_string(i));
+        rm1.emplace("another key too long for small string optimization " + std::to_string(i), i);
+    }
+    std::cout << "Serialized size: " << bin_srl::serialize(rv1, "test.bin") << std::endl;
+    std::pmr::vector<std::pmr::string> rv2(&arena);
+    std::cout << "Deserialized size: " << bin_srl::deserialize(rv2, "test.bin", &arena) << std::endl;
+    assert(rv1 == rv2);
+    bin_srl::serialize_buffer(rm1, buf);
+    std::istringstream rin(buf, std::ios::binary);
+    std::pmr::map<std::pmr::string, int> rm2(&arena);
+    before = allocations;
+    bin_srl::read_bin(rm2, rin);                                // every node and key goes to the arena
+    expect(allocations == before, "a read into the arena allocated from the heap");
+    assert(rm1 == rm2);
+    int ri = 42, *rp = &ri;
+    bin_srl::serialize(rp, "test.bin");
+    int *rq = nullptr;
+    bin_srl::deserialize(rq, "test.bin", &arena);
+    assert(*rq == 42 && (char *)rq >= block && (char *)rq < block + sizeof(block));
+    counting_resource shared;                                  // the chunks are read into it at the same time
+    std::pmr::vector<std::pmr::string> cr1;
+    std::vector<int> cri(500);
+    std::vector<int *> crp1;
+    for (int i = 0; i < 500; ++ i) {
+        cr1.emplace_back("a string too long for small string optimization " + std::to_string(i));
+        cri[i] = i;
+        crp1.push_back(&cri[i]);
+    }
+    bin_srl::chunk_options ropt;
+    ropt.chunk_size = 16;
+    ropt.threads = 4;
+    bin_srl::serialize_chunked(cr1, "test.bin", ropt);
+    std::pmr::vector<std::pmr::string> cr2(&shared);
+    std::cout << "Deserialized size: " << bin_srl::deserialize_chunked(cr2, "test.bin", &shared, ropt) << std::endl;
+    expect(cr1 == cr2 && cr2.back().get_allocator().resource() == &shared, "a chunked pmr vector was not read into the resource");
+    bin_srl::serialize_chunked(crp1, "test.bin", ropt);
+    std::vector<int *> crp2;
+    size_t shared_before = shared.count;
+    bin_srl::deserialize_chunked(crp2, "test.bin", &shared, ropt);
+    expect(shared.count - shared_before == crp1.size() && *crp2[321] == 321, "the chunk workers did not read into the resource");
+    std::pmr::list<std::pmr::string> crl(&shared);
+    bin_srl::serialize_chunked(cr1, "test.bin", ropt);
+    shared_before = shared.count;
+    bin_srl::deserialize_chunked(crl, "test.bin", &shared, ropt);
+    expect(crl.size() == cr1.size() && crl.back() == cr1.back(), "a chunked pmr list differs");
+    expect(shared.count - shared_before == 2 * cr1.size(), "a chunked pmr list was copied between resources");
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing shared pointers" << std::endl;
+    Node n1, n2;
+    type_info::RegisterStruct<Node>("Node", n1, {
+        {"val", n1.val},
+        {"next", n1.next},
+        {"label", n1.label}
+    });
+    n1.val = 1;
+    n1.next = &n2;
+    n1.label = std::make_shared<std::string>("a label shared by both nodes");
+    n2.val = 2;
+    n2.next = &n1;                                              // a cycle
+    n2.label = n1.label;
+    Node *head = &n1;
+    std::cout << "Serialized size: " << bin_srl::serialize(head, "test.bin") << std::endl;
+    Node *copy = nullptr;
+    std::cout << "Deserialized size: " << bin_srl::deserialize(copy, "test.bin") << std::endl;
+    assert(copy->val == 1 && copy->next->val == 2 && copy->next->next == copy);
+    assert(copy->label == copy->next->label && *copy->label == *n1.label);
+    delete copy->next;
+    delete copy;
+    std::vector<std::shared_ptr<std::string>> sv1 = {n1.label, nullptr, n1.label};
+    std::cout << "Serialized size: " << bin_srl::serialize(sv1, "test.bin") << std::endl;
+    assert(bin_srl::serialized_size(sv1) == 4 * sizeof(unsigned int) + bin_srl::serialized_size(*n1.label));
+    std::vector<std::shared_ptr<std::string>> sv2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize(sv2, "test.bin") << std::endl;
+    assert(sv2.size() == 3 && sv2[0] == sv2[2] && sv2[1] == nullptr && *sv2[0] == *n1.label);
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing record log" << std::endl;
+    std::remove("test.log");
+    std::remove("test.log.idx");
+    {
+        bin_srl::record_writer log("test.log");
+        for (int k = 0; k < 100; ++ k) {
+            if (k % 3 == 0) {
+                log.append("record " + std::to_string(k));
+            } else {
+                log.append(k);
+            }
+        }
+    }
+    {
+        bin_srl::record_writer log("test.log", false);                 // appended behind the side index
+        log.append(std::vector<int>{1, 2, 3});
+    }
+    bin_srl::record_reader records("test.log");
+    std::cout << "Records: " << records.count() << std::endl;
+    assert(records.count() == 101);
+    std::string record;
+    records.read(57, record);
+    assert(record == "record 57");
+    int rk = 0;
+    records.read(58, rk);
+    assert(rk == 58);
+    std::vector<int> rv;
+    records.read(100, rv);
+    assert(rv == std::vector<int>({1, 2, 3}));
+    int strings = 0, ints = 0;
+    for (records.rewind(); records.next(); ) {
+        if (records.holds<std::string>()) {
+            ++ strings;
+        } else if (records.holds<int>()) {
+            records.get(rk);
+            ints += rk;
+        }
+    }
+    assert(strings == 34 && ints == 4950 - 1683);
+    bool mismatch = false;
+    try {
+        records.read(0, rk);
+    } catch (const std::runtime_error &) {
+        mismatch = true;
+    }
+    expect(mismatch, "a record was read with the wrong schema");
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing sequence reader" << std::endl;
+    std::vector<int> seq1(1000);
+    for (int k = 0; k < 1000; ++ k) seq1[k] = rand();
+    std::cout << "Serialized size: " << bin_srl::serialize(seq1, "test.bin") << std::endl;
+    bin_srl::sequence_reader<int> seq_ints("test.bin");
+    assert(seq_ints.size() == 1000);
+    std::vector<int> seq2(seq_ints.begin(), seq_ints.end());
+    assert(seq1 == seq2);
+    bin_srl::serialize(sv1, "test.bin");
+    bin_srl::sequence_reader<std::shared_ptr<std::string>> seq_labels("test.bin");
+    std::vector<std::shared_ptr<std::string>> sv3;
+    for (const auto &label : seq_labels) {
+        sv3.push_back(label);
+    }
+    assert(sv3.size() == 3 && sv3[0] == sv3[2] && sv3[1] == nullptr && *sv3[0] == *n1.label);
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing sequence writer" << std::endl;
+    bin_srl::sequence_writer<int> seq_out("test.bin");
+    for (int v : seq1) {
+        seq_out.push(v);
+    }
+    std::cout << "Serialized size: " << seq_out.end() << std::endl;
+    seq2.clear();
+    std::cout << "Deserialized size: " << bin_srl::deserialize(seq2, "test.bin") << std::endl;
+    assert(seq1 == seq2);
+    {
+        bin_srl::sequence_writer<std::shared_ptr<std::string>> labels_out("test.bin");
+        for (const auto &label : sv1) {
+            labels_out.push(label);
+        }
+    }                                                               // finished by the destructor
+    sv3.clear();
+    bin_srl::deserialize(sv3, "test.bin");
+    assert(sv3.size() == 3 && sv3[0] == sv3[2] && sv3[1] == nullptr && *sv3[0] == *n1.label);
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing indexed encoding" << std::endl;
+    Outer outer;
+    type_info::RegisterStruct<Outer>("Outer", outer, {
+        {"id", outer.id},
+        {"inner", outer.inner},
+        {"tags", outer.tags},
+        {"node", outer.node},
+        {"weight", outer.weight}
+    });
+    outer.id = 7;
+    outer.inner = pv1[3];
+    outer.tags = {"first", "second", "third"};
+    outer.node = n1;
+    outer.weight = 0.25;
+    std::cout << "Serialized size: " << bin_srl::serialize_indexed(outer, "test.bin") << std::endl;
+    float inner_b = 0;
+    bin_srl::read_member<Outer>("test.bin", "inner.b", inner_b);
+    assert(inner_b == outer.inner.b);
+    double weight = 0;
+    bin_srl::read_member<Outer>("test.bin", "weight", weight);
+    assert(weight == outer.weight);
+    std::vector<std::string> tags;
+    bin_srl::read_member<Outer>("test.bin", "tags", tags);
+    assert(tags == outer.tags);
+    std::shared_ptr<std::string> node_label;
+    bin_srl::read_member<Outer>("test.bin", "node.label", node_label);
+    assert(*node_label == *n1.label);
+    P inner;
+    bin_srl::read_member<Outer>("test.bin", "inner", inner);
+    assert(memcmp(&inner, &outer.inner, sizeof(P)) == 0);
+    bool missing = false;
+    try {
+        bin_srl::read_member<Outer>("test.bin", "inner.d", inner_b);
+    } catch (const std::runtime_error &) {
+        missing = true;
+    }
+    expect(missing, "a member that does not exist was read");
+    Outer outer2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize_indexed(outer2, "test.bin") << std::endl;
+    assert(outer2.id == outer.id && outer2.tags == outer.tags && outer2.weight == outer.weight);
+    assert(outer2.node.val == n1.val && outer2.node.next->val == n2.val && *outer2.node.label == *n1.label);
+    delete outer2.node.next->next;
+    delete outer2.node.next;
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing projection" << std::endl;
+    std::cout << "Serialized size: " << bin_srl::serialize(outer, "test.bin") << std::endl;
+    Outer outer3;
+    outer3.id = -1;
+    outer3.inner.a = -1;
+    outer3.node.next = nullptr;
+    std::cout << "Deserialized size: " << bin_srl::deserialize_projection(outer3, "test.bin", {"weight", "inner.b", "tags", "node.val"}) << std::endl;
+    assert(outer3.weight == outer.weight && outer3.inner.b == outer.inner.b && outer3.tags == outer.tags && outer3.node.val == n1.val);
+    assert(outer3.id == -1 && outer3.inner.a == -1 && outer3.node.next == nullptr);
+    bool skipped_ref = false;
+    try {
+        bin_srl::deserialize_projection(outer3, "test.bin", {"node.label"});   // its object was written under node.next
+    } catch (const std::runtime_error &) {
+        skipped_ref = true;
+    }
+    expect(skipped_ref, "a projection through a skipped reference was accepted");
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing columnar encoding" << std::endl;
+    std::vector<Outer> rows1(50);
+    for (int k = 0; k < 50; ++ k) {
+        rows1[k].id = k;
+        rows1[k].inner = pv1[k % pv1.size()];
+        rows1[k].tags = {"row", std::to_string(k)};
+        rows1[k].node.val = -k;
+        rows1[k].node.next = nullptr;
+        rows1[k].node.label = n1.label;                             // one object shared by all the rows
+        rows1[k].weight = k * 0.125;
+    }
+    std::cout << "Serialized size: " << bin_srl::serialize_columnar(rows1, "test.bin") << std::endl;
+    std::vector<Outer> rows2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize_columnar(rows2, "test.bin") << std::endl;
+    assert(rows2.size() == rows1.size());
+    for (int k = 0; k < 50; ++ k) {
+        assert(rows2[k].id == k && memcmp(&rows2[k].inner, &rows1[k].inner, sizeof(P)) == 0 && rows2[k].tags == rows1[k].tags);
+        assert(rows2[k].node.val == -k && rows2[k].node.next == nullptr && rows2[k].weight == rows1[k].weight);
+        assert(rows2[k].node.label == rows2[0].node.label && *rows2[k].node.label == *n1.label);
+    }
+    std::vector<double> weights;
+    bin_srl::read_column<Outer>("test.bin", "weight", weights);
+    assert(weights.size() == 50 && weights[49] == rows1[49].weight);
+    std::vector<std::vector<std::string>> tag_column;
+    bin_srl::read_column<Outer>("test.bin", "tags", tag_column);
+    assert(tag_column[7] == rows1[7].tags);
+    bool wrong_type = false;
+    try {
+        bin_srl::read_column<Outer>("test.bin", "node.val", weights);
+    } catch (const std::runtime_error &) {
+        wrong_type = true;
+    }
+    expect(wrong_type, "a column was read into the wrong type");
+    {
+        std::fstream damaged("test.bin", std::ios::binary | std::ios::in | std::ios::out);
+        unsigned int rows = 0x40000000;
+        damaged.write(reinterpret_cast<const char *>(&rows), sizeof(rows));     // far more rows than the file holds
+    }
+    bool bad_rows = false, bad_column_rows = false;
+    try {
+        bin_srl::deserialize_columnar(rows2, "test.bin");
+    } catch (const std::runtime_error &) {
+        bad_rows = true;
+    }
+    try {
+        bin_srl::read_column<Outer>("test.bin", "tags", tag_column);
+    } catch (const std::runtime_error &) {
+        bad_column_rows = true;
+    }
+    expect(bad_rows && bad_column_rows, "a columnar row count beyond the data was accepted");
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing packed keys" << std::endl;
+    std::set<int> ids1;
+    for (int k = 0; k < 10000; ++ k) ids1.insert(1000000 + 3 * k);
+    unsigned int ids_size = bin_srl::serialize(ids1, "test.bin");
+    unsigned int packed_size = bin_srl::serialize_packed(ids1, "test.bin");
+    std::cout << "Serialized size: " << packed_size << std::endl;
+    expect(ids_size > 3 * packed_size, "dense keys were not packed");
+    std::set<int> ids2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize_packed(ids2, "test.bin") << std::endl;
+    assert(ids1 == ids2);
+    std::multimap<int64_t, std::string> pm1 = {{-5, "a"}, {-5, "b"}, {7, "c"}, {INT64_MAX, "d"}, {INT64_MIN, "e"}};
+    std::map<unsigned short, double> pm3 = {{1, 0.5}, {2, 1.5}, {65535, 2.5}};     // smaller in full
+    for (int k = 0; k < 100; ++ k) pm1.emplace(k, "x");                             // smaller as steps
+    {
+        type_info::packed_scope packed;
+        unsigned int pm_size = bin_srl::serialize(pm1, "test.bin");
+        std::cout << "Serialized size: " << pm_size << std::endl;
+        assert(bin_srl::serialized_size(pm1) == pm_size);
+        std::ifstream packed_file("test.bin", std::ios::binary);
+        size_t pm_skipped = bin_srl::skip_bin<decltype(pm1)>(packed_file);
+        expect(pm_skipped == pm_size && packed_file.peek() == EOF, "skip_bin passed over a packed map wrongly");
+        packed_file.close();
+        decltype(pm1) pm2;
+        bin_srl::deserialize(pm2, "test.bin");
+        assert(pm1 == pm2);
+        bin_srl::serialize(pm3, "test.bin");
+        decltype(pm3) pm4;
+        bin_srl::deserialize(pm4, "test.bin");
+        assert(pm3 == pm4);
+        A pa1, pa2;
+        setStruct(pa1);
+        unsigned int pa_size = bin_srl::serialize(pa1, "test.bin");
+        std::cout << "Serialized size: " << pa_size << std::endl;
+        assert(bin_srl::serialized_size(pa1) == pa_size);
+        std::cout << "Deserialized size: " << bin_srl::deserialize(pa2, "test.bin") << std::endl;
+        checkStruct(pa1, pa2);
+    }
+    std::vector<std::set<int>> pc1(200);
+    for (int i = 0; i < 200; ++ i) {
+        for (int k = 0; k < 100; ++ k) pc1[i].insert(1000000 * i + k);
+    }
+    bin_srl::chunk_options popt;
+    popt.chunk_size = 8;
+    popt.threads = 4;
+    unsigned int pc_full = bin_srl::serialize_chunked(pc1, "test.bin", popt);
+    {
+        type_info::packed_scope packed;                             // the chunk workers pack too
+        unsigned int pc_size = bin_srl::serialize_chunked(pc1, "test.bin", popt);
+        std::cout << "Serialized size: " << pc_size << std::endl;
+        expect(pc_size < pc_full / 3, "the chunk workers did not pack the keys");
+        std::vector<std::set<int>> pc2;
+        bin_srl::deserialize_chunked(pc2, "test.bin", popt);
+        expect(pc1 == pc2, "chunked packed sets differ");
+        std::ifstream chunked("test.bin", std::ios::binary);
+        std::vector<std::set<int>> pc3;
+        bin_srl::read_bin_chunked(pc3, chunked);
+        expect(pc1 == pc3, "chunked packed sets read from a stream differ");
+        bin_srl::serialize_chunked(ids1, "test.bin", popt);         // the elements of a chunk are never packed together
+        std::ifstream chunked_ids("test.bin", std::ios::binary);
+        std::set<int> ids3;
+        bin_srl::read_bin_chunked(ids3, chunked_ids);
+        expect(ids1 == ids3, "a chunked set read from a stream in a packed scope differs");
+    }
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing string dictionary" << std::endl;
+    std::vector<A> da1(100);
+    for (auto &da : da1) setStruct(da);                             // the keys of e repeat in every element
+    unsigned int full_size = bin_srl::serialize(da1, "test.bin");
+    unsigned int dictionary_size = bin_srl::serialize_dictionary(da1, "test.bin");
+    std::cout << "Serialized size: " << dictionary_size << std::endl;
+    expect(dictionary_size < full_size, "the dictionary did not make repeated keys smaller");
+    std::vector<A> da2;
+    unsigned int dictionary_read = bin_srl::deserialize_dictionary(da2, "test.bin");
+    std::cout << "Deserialized size: " << dictionary_read << std::endl;
+    assert(dictionary_read == dictionary_size);
+    assert(da2.size() == da1.size() && da2[99].e == da1[99].e && da2[99].c == da1[99].c && da2[99].f == da1[99].f);
+    std::vector<std::string> dv1 = {"label", "", "other", "label", "", "label"};
+    {
+        type_info::dictionary_scope dictionary;
+        unsigned int dv_size = bin_srl::serialize(dv1, "test.bin");
+        std::cout << "Serialized size: " << dv_size << std::endl;
+        assert(bin_srl::serialized_size(dv1) == dv_size);
+        std::ifstream dictionary_file("test.bin", std::ios::binary);
+        size_t dv_skipped = bin_srl::skip_bin<decltype(dv1)>(dictionary_file);
+        expect(dv_skipped == dv_size, "skip_bin passed over dictionary strings wrongly");
+        dictionary_file.close();
+        std::vector<std::string> dv2;
+        bin_srl::deserialize(dv2, "test.bin");
+        assert(dv1 == dv2);
+    }
+    std::vector<std::string> dc1;
+    for (int i = 0; i < 1000; ++ i) {
+        dc1.push_back("a label repeated in every chunk " + std::to_string(i % 5));
+    }
+    bin_srl::chunk_options dopt;
+    dopt.chunk_size = 32;
+    dopt.threads = 4;
+    unsigned int dc_full = bin_srl::serialize_chunked(dc1, "test.bin", dopt);
+    {
+        type_info::dictionary_scope dictionary;                     // on the chunk workers too, one dictionary per chunk
+        unsigned int dc_size = bin_srl::serialize_chunked(dc1, "test.bin", dopt);
+        std::cout << "Serialized size: " << dc_size << std::endl;
+        expect(dc_size < dc_full / 3, "the chunk workers did not share the strings within a chunk");
+        std::vector<std::string> dc2;
+        bin_srl::deserialize_chunked(dc2, "test.bin", dopt);
+        expect(dc1 == dc2, "chunked dictionary strings differ");
+        std::ifstream chunked("test.bin", std::ios::binary);
+        std::vector<std::string> dc3;
+        bin_srl::read_bin_chunked(dc3, chunked);
+        expect(dc1 == dc3, "chunked dictionary strings read from a stream differ");
+    }
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing checkpoint" << std::endl;
+    A ca1, ca2;
+    setStruct(ca1);
+    bin_srl::checkpoint<A> cp(ca1);
+    std::string base_buf, patch;
+    bin_srl::serialize_buffer(ca1, base_buf);
+    assert(cp.data() == base_buf);
+    size_t changed = cp.update(ca1, patch);
+    size_t applied = bin_srl::apply_patch(base_buf, patch);
+    expect(changed == 0 && applied == 0, "an unchanged struct produced a patch");
+    ca1.a = 7;                                                      // same size, rewritten in place
+    ca1.c = "a longer string than before";                          // the members after it move
+    changed = cp.update(ca1, patch);
+    expect(changed == 2, "the two changed members were not found");
+    std::cout << "Patch size: " << patch.size() << " of " << cp.data().size() << std::endl;
+    assert(patch.size() < cp.data().size());
+    applied = bin_srl::apply_patch(base_buf, patch);
+    expect(applied == 2 && base_buf == cp.data(), "the patch did not rebuild the checkpoint");
+    ca1.e["100"] = -1;
+    ca1.f.clear();
+    ca1.b = 2.5;                                                    // not named, so not seen
+    changed = cp.update(ca1, {"e", "f"}, patch);
+    expect(changed == 2, "the two named members were not found changed");
+    bin_srl::apply_patch(base_buf, patch);
+    std::cout << "Deserialized size: " << bin_srl::deserialize_buffer(ca2, base_buf) << std::endl;
+    assert(ca2.a == 7 && ca2.c == ca1.c && ca2.e == ca1.e && ca2.f.empty() && ca2.b != 2.5);
+    changed = cp.update(ca1, patch);
+    expect(changed == 1, "the member changed outside the names was not found");
+    bin_srl::apply_patch(base_buf, patch);
+    std::string full_buf;
+    bin_srl::serialize_buffer(ca1, full_buf);
+    assert(base_buf == full_buf);
+    bool bad_patch = false;
+    try {
+        bin_srl::apply_patch(base_buf, patch.substr(0, patch.size() - 1));
+    } catch (const std::runtime_error &) {
+        bad_patch = true;
+    }
+    expect(bad_patch, "a truncated patch was applied");
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing compression" << std::endl;
+    std::vector<int> zv1(100000);
+    for (int k = 0; k < 100000; ++ k) zv1[k] = k % 100;
+    std::cout << "Serialized size: " << bin_srl::serialize_compressed(zv1, "test.bin") << std::endl;
+    std::ifstream compressed_file("test.bin", std::ios::binary | std::ios::ate);
+    std::cout << "Compressed size: " << compressed_file.tellg() << std::endl;
+    assert((size_t)compressed_file.tellg() < zv1.size() * sizeof(int) / 10);
+    compressed_file.close();
+    std::vector<int> zv2;
+    std::cout << "Deserialized size: " << bin_srl::deserialize_compressed(zv2, "test.bin") << std::endl;
+    assert(zv1 == zv2);
+    block_stream::options stored;
+    stored.block_size = 1000;
+    stored.codec = block_stream::codec_none;
+    bin_srl::serialize_compressed(seq1, "test.bin", stored);
+    seq2.clear();
+    bin_srl::deserialize_compressed(seq2, "test.bin");
+    assert(seq1 == seq2);
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing block checksums" << std::endl;
+    assert(block_stream::crc32c("123456789", 9) == 0xe3069283u);
+    assert(~block_stream::crc32c_table_(~0u, "123456789", 9) == 0xe3069283u);        // the fallback, whatever the processor has
+    std::string crc_bytes(1001, '\0');
+    for (char &c : crc_bytes) c = (char)rand();
+    assert(~block_stream::crc32c_table_(~0u, crc_bytes.data(), crc_bytes.size()) == block_stream::crc32c(crc_bytes.data(), crc_bytes.size()));
+    {
+        std::fstream damaged("test.bin", std::ios::binary | std::ios::in | std::ios::out);
+        damaged.seekg(2000);
+        char byte = damaged.get();
+        damaged.seekp(2000);
+        damaged.put(byte ^ 0x10);                                   // one bit flipped in the second block
+    }
+    bool damaged_read = false;
+    try {
+        seq2.clear();
+        bin_srl::deserialize_compressed(seq2, "test.bin");
+    } catch (const std::runtime_error &) {
+        damaged_read = true;
+    }
+    expect(damaged_read, "a damaged compressed block was accepted");
+
     std::cout << "===========================" << std::endl;
 }
 
@@ -316,6 +1053,36 @@ void test_xml_srl() {
         assert(v[i] == w[i]);
     }
 
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing batch" << std::endl;
+    std::vector<std::string> files;
+    for (int i = 0; i < 8; ++ i) {
+        files.push_back("test" + std::to_string(i) + ".xml");
+        std::vector<int> bv(i, i);
+        std::cout << "Serialized count: " << xml_srl::serialize(bv, "vector", files.back().c_str()) << std::endl;
+    }
+    std::vector<std::vector<int>> bw;
+    std::cout << "Deserialized count: " << xml_srl::deserialize_batch(bw, files, "vector", 4) << std::endl;
+    assert(bw.size() == files.size());
+    for (int i = 0; i < (int)bw.size(); ++ i) {
+        assert(bw[i] == std::vector<int>(i, i));
+        std::remove(files[i].c_str());
+    }
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing parallel parse" << std::endl;
+    std::vector<std::string> pv1;
+    for (int i = 0; i < 1000; ++ i) {
+        pv1.push_back(std::to_string(rand()));
+    }
+    std::cout << "Serialized count: " << xml_srl::serialize(pv1, "vector", "test.xml") << std::endl;
+    std::vector<std::string> pv2;
+    std::cout << "Deserialized count: " << xml_srl::deserialize_parallel(pv2, "vector", "test.xml", 4) << std::endl;
+    assert(pv1 == pv2);
+    pv2.clear();
+    xml_srl::deserialize_parallel(pv2, "vector", "test.xml", 4, true);          // read from the finalized document
+    assert(pv1 == pv2);
+
     std::cout << "===========================" << std::endl;
     std::cout << "Testing map" << std::endl;
     std::map<std::string, int> m;
@@ -378,6 +1145,160 @@ void test_xml_srl() {
     std::cout << "Deserialized count: " << xml_srl::deserialize(bmptr, "uniqueptr_struct", "test.xml") << std::endl;
     checkStruct(*amptr, *bmptr);
 
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing shared pointers" << std::endl;
+    Node n1, n2;
+    type_info::RegisterStruct<Node>("Node", n1, {
+        {"val", n1.val},
+        {"next", n1.next},
+        {"label", n1.label}
+    });
+    n1.val = 1;
+    n1.next = &n2;
+    n1.label = std::make_shared<std::string>("a label shared by both nodes");
+    n2.val = 2;
+    n2.next = &n1;
+    n2.label = n1.label;
+    Node *head = &n1;
+    std::cout << "Serialized count: " << xml_srl::serialize(head, "node", "test.xml") << std::endl;
+    Node *copy = nullptr;
+    std::cout << "Deserialized count: " << xml_srl::deserialize(copy, "node", "test.xml") << std::endl;
+    assert(copy->val == 1 && copy->next->val == 2 && copy->next->next == copy);
+    assert(copy->label == copy->next->label && *copy->label == *n1.label);
+    delete copy->next;
+    delete copy;
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing sequence reader" << std::endl;
+    std::vector<A> seq1(3);
+    for (auto &a : seq1) setStruct(a);
+    seq1[1].c = "<not a tag> & \"quoted\"";
+    std::cout << "Serialized count: " << xml_srl::serialize(seq1, "structs", "test.xml") << std::endl;
+    xml_srl::sequence_reader<A> seq_structs("structs", "test.xml");
+    int seq_count = 0;
+    A seq_struct;
+    while (seq_structs.next(seq_struct)) {
+        checkStruct(seq1[seq_count ++], seq_struct);
+    }
+    assert(seq_count == 3);
+    std::vector<std::shared_ptr<std::string>> sv1 = {n1.label, nullptr, n1.label};
+    xml_srl::serialize(sv1, "labels", "test.xml");
+    xml_srl::sequence_reader<std::shared_ptr<std::string>> seq_labels("labels", "test.xml");
+    std::vector<std::shared_ptr<std::string>> sv2(seq_labels.begin(), seq_labels.end());
+    assert(sv2.size() == 3 && sv2[0] == sv2[2] && sv2[1] == nullptr && *sv2[0] == *n1.label);
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing sequence writer" << std::endl;
+    xml_srl::sequence_writer<A> seq_out("structs", "test2.xml");
+    for (const A &a : seq1) {
+        seq_out.push(a);
+    }
+    std::cout << "Serialized count: " << seq_out.end() << std::endl;
+    xml_srl::serialize(seq1, "structs", "test.xml");
+    std::ifstream whole_file("test.xml"), pushed_file("test2.xml");
+    std::string whole((std::istreambuf_iterator<char>(whole_file)), std::istreambuf_iterator<char>());
+    std::string pushed((std::istreambuf_iterator<char>(pushed_file)), std::istreambuf_iterator<char>());
+    assert(whole == pushed);
+    {
+        xml_srl::sequence_writer<std::shared_ptr<std::string>> labels_out("labels", "test2.xml");
+        for (const auto &label : sv1) {
+            labels_out.push(label);
+        }
+    }
+    sv2.clear();
+    xml_srl::deserialize(sv2, "labels", "test2.xml");
+    assert(sv2.size() == 3 && sv2[0] == sv2[2] && sv2[1] == nullptr && *sv2[0] == *n1.label);
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing compression" << std::endl;
+    std::cout << "Serialized count: " << xml_srl::serialize_compressed(seq1, "structs", "test2.xml") << std::endl;
+    std::ifstream compressed_file("test2.xml", std::ios::binary | std::ios::ate);
+    std::cout << "Compressed size: " << compressed_file.tellg() << " of " << whole.size() << std::endl;
+    assert((size_t)compressed_file.tellg() < whole.size() / 2);
+    compressed_file.close();
+    std::vector<A> seq3;
+    std::cout << "Deserialized count: " << xml_srl::deserialize_compressed(seq3, "structs", "test2.xml") << std::endl;
+    assert(seq3.size() == 3);
+    for (int k = 0; k < 3; ++ k) {
+        checkStruct(seq1[k], seq3[k]);
+    }
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing projection" << std::endl;
+    Outer outer;
+    outer.id = 7;
+    outer.inner = {1, 2.5f, "inner"};
+    outer.tags = {"first", "second", "third"};
+    outer.node = n1;
+    outer.weight = 0.25;
+    std::cout << "Serialized count: " << xml_srl::serialize(outer, "outer", "test.xml") << std::endl;
+    Outer outer3;
+    outer3.id = -1;
+    outer3.inner.a = -1;
+    outer3.node.next = nullptr;
+    std::cout << "Deserialized count: " << xml_srl::deserialize_projection(outer3, "outer", "test.xml", {"weight", "inner.b", "tags", "node.val"}) << std::endl;
+    assert(outer3.weight == outer.weight && outer3.inner.b == outer.inner.b && outer3.tags == outer.tags && outer3.node.val == n1.val);
+    assert(outer3.id == -1 && outer3.inner.a == -1 && outer3.node.next == nullptr);
+    outer3.node.label = nullptr;
+    xml_srl::deserialize_projection(outer3, "outer", "test.xml", {"node.next"});
+    assert(outer3.node.next->val == n2.val && *outer3.node.next->label == *n1.label && outer3.node.label == nullptr);
+    delete outer3.node.next->next;
+    delete outer3.node.next;
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing compact document" << std::endl;
+    tinyxml2::XMLDocument full;
+    tinyxml2::XMLCompactDocument compact(true, true);
+    tinyxml2::XMLError full_err = full.LoadFile("test.xml");
+    tinyxml2::XMLError compact_err = compact.LoadFile("test.xml");
+    expect(full_err == tinyxml2::XML_SUCCESS && compact_err == tinyxml2::XML_SUCCESS, "test.xml did not load");
+    auto same = [](auto &self, const tinyxml2::XMLNode *x, tinyxml2::XMLCompactNode y) -> void {
+        for (x = x->FirstChild(), y = y.FirstChild(); x; x = x->NextSibling(), y = y.NextSibling()) {
+            assert(y && std::string(x->Value()) == y.Value() && x->GetLineNum() == y.GetLineNum());
+            if (const tinyxml2::XMLElement *e = x->ToElement()) {
+                int i = 0;
+                for (const tinyxml2::XMLAttribute *at = e->FirstAttribute(); at; at = at->Next(), ++ i) {
+                    assert(std::string(at->Name()) == y.AttributeName(i) && std::string(at->Value()) == y.AttributeValue(i));
+                }
+                assert(i == y.AttributeCount() && (e->GetText() == nullptr) == (y.GetText() == nullptr));
+            }
+            self(self, x, y);
+        }
+        assert(!y);
+    };
+    same(same, &full, compact.Document());
+    int compact_id = 0;
+    tinyxml2::XMLCompactNode compact_id_elem = compact.RootElement("serialization").FirstChildElement("outer").FirstChildElement("id");
+    compact_err = compact_id_elem.QueryIntAttribute("val", &compact_id);
+    expect(compact_err == tinyxml2::XML_SUCCESS && compact_id == outer.id, "the compact id attribute differs");
+    assert(compact_id_elem.Parent().Name() == std::string("outer") && !compact_id_elem.FirstChildElement("missing"));
+    compact.SetUserData(compact_id_elem, &compact_id);
+    assert(compact_id_elem.GetUserData() == &compact_id);
+    std::cout << "Nodes: " << compact.NodeCount() << ", compact bytes: " << compact.MemoryUsage() << std::endl;
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Testing finalize" << std::endl;
+    tinyxml2::XMLDocument fin_doc;
+    tinyxml2::XMLError fin_err = fin_doc.LoadFile("test.xml");
+    expect(fin_err == tinyxml2::XML_SUCCESS, "test.xml did not load for finalize");
+    tinyxml2::XMLPrinter before;
+    fin_doc.Print(&before);
+    fin_doc.Finalize();
+    tinyxml2::XMLPrinter after;
+    fin_doc.Print(&after);
+    assert(std::string(before.CStr()) == after.CStr());
+    tinyxml2::XMLElement *fin_outer = tinyxml2::XMLHandle(fin_doc).FirstChildElement("serialization").FirstChildElement("outer").ToElement();
+    assert(fin_outer != nullptr);
+    if (fin_outer != nullptr) {
+        assert(fin_outer->FirstChildElement("id")->IntAttribute("val") == outer.id);
+        assert((char *)fin_outer->FirstChildElement("id") < (char *)fin_outer->FirstChildElement("id")->NextSiblingElement());
+        fin_outer->DeleteChild(fin_outer->FirstChildElement("weight"));
+        fin_outer->InsertNewChildElement("extra")->SetAttribute("val", 3);
+        fin_doc.Finalize();
+        fin_outer = tinyxml2::XMLHandle(fin_doc).FirstChildElement("serialization").FirstChildElement("outer").ToElement();
+        assert(fin_outer != nullptr && !fin_outer->FirstChildElement("weight") && fin_outer->LastChildElement("extra")->IntAttribute("val") == 3);
+    }
+
     std::cout << "===========================" << std::endl;
 }
 